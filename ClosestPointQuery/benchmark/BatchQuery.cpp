@@ -0,0 +1,67 @@
+#include <future>
+#include <iostream>
+#include "Benchmark.h"
+
+namespace benchmark {
+
+	// Number of query points handed to std::async at a time, as the example used to do before query_batch.
+	const size_t ASYNC_TASK_COUNT = 256;
+
+	// Query every point with one std::async task each, waiting for ASYNC_TASK_COUNT tasks at a time. Return the time in milliseconds.
+	double run_async_queries(const ClosestPointQuery& query, const std::vector<Point>& query_points, size_t& found_count) {
+		std::vector<Point> closest_points(query_points.size());
+		found_count = 0;
+		Timer timer;
+		for (size_t i = 0; i < query_points.size(); i += ASYNC_TASK_COUNT) {
+			const size_t task_count = std::min(ASYNC_TASK_COUNT, query_points.size() - i);
+			std::vector<std::future<bool>> tasks(task_count);
+			for (size_t j = 0; j < task_count; ++j) {
+				tasks[j] = std::async(std::launch::async, [&query, &query_points, &closest_points](size_t k) { return query(query_points[k], QUERY_MAX_DISTANCE, closest_points[k]); }, i + j);
+			}
+			for (size_t j = 0; j < task_count; ++j) found_count += tasks[j].get();
+		}
+		return timer.elapsed_ms();
+	}
+	// Query every point with query_batch on a pool of the given size. Return the time in milliseconds.
+	double run_batch_queries(const ClosestPointQuery& query, const std::vector<Point>& query_points, ThreadPool& thread_pool, size_t& found_count) {
+		std::vector<uint8_t> found(query_points.size());
+		std::vector<Point> closest_points(query_points.size());
+		const float max_dist = QUERY_MAX_DISTANCE;
+		Timer timer;
+		QueryOptions options;
+		options.thread_pool = &thread_pool;
+		query.query_batch(query_points, Span<const float>(&max_dist, 1), found, closest_points, options);
+		const double ms = timer.elapsed_ms();
+		found_count = 0;
+		for (uint8_t f : found) found_count += f;
+		return ms;
+	}
+
+	// Compare query_batch on the persistent pool, from serial up to the hardware concurrency, against a std::async task per query point.
+	void batch_query(const std::vector<Model>& models) {
+		std::vector<size_t> thread_counts;
+		const size_t max_thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+		for (size_t thread_count = 1; thread_count < max_thread_count; thread_count *= 2) thread_counts.push_back(thread_count);
+		thread_counts.push_back(max_thread_count);
+		const std::vector<Point> query_points = random_query_points(QUERY_POINT_COUNT, QUERY_SPHERE_RADIUS);
+
+		std::cout << "| Model Name | Triangles | Method | Threads | Query Time | Speedup | Found |\n";
+		std::cout << "| :--------- | :-------- | :----- | :------ | :--------- | :------ | :---- |\n";
+		for (const Model& model : models) {
+			const ClosestPointQuery query(model.mesh);
+			double serial_ms = 0.0;
+			size_t found_count = 0;
+			for (size_t thread_count : thread_counts) {
+				ThreadPool thread_pool(thread_count);
+				const double ms = run_batch_queries(query, query_points, thread_pool, found_count);
+				if (thread_count == 1) serial_ms = ms;
+				std::cout << "| " << model.name << " | " << model.triangle_count() << " | query_batch | " << thread_count;
+				std::cout << " | " << ms / 1000.0 << "s | " << serial_ms / ms << "x | " << found_count << " |\n";
+			}
+			const double async_ms = run_async_queries(query, query_points, found_count);
+			std::cout << "| " << model.name << " | " << model.triangle_count() << " | std::async | " << ASYNC_TASK_COUNT;
+			std::cout << " | " << async_ms / 1000.0 << "s | " << serial_ms / async_ms << "x | " << found_count << " |\n";
+		}
+	}
+
+} // namespace benchmark
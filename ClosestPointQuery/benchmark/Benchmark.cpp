@@ -0,0 +1,133 @@
+#define TINYOBJLOADER_IMPLEMENTATION
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <tiny_obj_loader.h>
+#include "Benchmark.h"
+
+using namespace benchmark;
+
+// Constants declarations
+const char* DEFAULT_MODEL_PATHS[] = {
+	"../../../Assets/bunny.obj",
+	"../../../Assets/armadillo.obj",
+	"../../../Assets/head.obj",
+};
+
+// A benchmark suite that can be selected from the command line.
+struct Suite {
+	const char* name;
+	void (*run)(const std::vector<Model>& models);
+};
+const Suite SUITES[] = {
+	{ "construction", tree_construction },
+	{ "parallel_construction", parallel_construction },
+	{ "query", tree_query },
+	{ "leaf_size", leaf_size },
+	{ "triangle_kernel", triangle_kernel },
+	{ "vec3_backend", vec3_backend },
+	{ "batch_query", batch_query },
+	{ "query_order", query_order },
+	{ "traversal", traversal },
+	{ "grid_bake", grid_bake },
+	{ "distance_field", distance_field },
+	{ "scene", scene },
+	{ "vertex_storage", vertex_storage },
+	{ "node_bounds", node_bounds },
+};
+
+// Forward declarations
+bool load_obj_model(const char* model_path, Model& model);
+
+// Usage: Benchmark [suite|all] [model.obj ...]
+// Runs every suite on bunny, armadillo and head by default. Models that can't be found are skipped.
+int main(int argc, char** argv) {
+	const char* suite_name = argc > 1 ? argv[1] : "all";
+	std::vector<const char*> model_paths(argv + std::min(argc, 2), argv + argc);
+	if (model_paths.empty()) model_paths.assign(std::begin(DEFAULT_MODEL_PATHS), std::end(DEFAULT_MODEL_PATHS));
+
+	std::vector<Model> models;
+	for (const char* path : model_paths) {
+		Model model;
+		if (load_obj_model(path, model)) models.push_back(std::move(model));
+		else std::cerr << "Skipping " << path << ", model can't be loaded.\n";
+	}
+	if (models.empty()) return -1;
+
+	bool found = false;
+	for (const Suite& suite : SUITES) {
+		if (strcmp(suite_name, "all") != 0 && strcmp(suite_name, suite.name) != 0) continue;
+		std::cout << "## " << suite.name << "\n";
+		suite.run(models);
+		std::cout << "\n";
+		found = true;
+	}
+	if (!found) {
+		std::cerr << "Unknown suite " << suite_name << ", available suites:";
+		for (const Suite& suite : SUITES) std::cerr << " " << suite.name;
+		std::cerr << "\n";
+		return -1;
+	}
+	return 0;
+}
+
+// Load an OBJ model and merge all of its shapes into a single mesh.
+bool load_obj_model(const char* model_path, Model& model) {
+	tinyobj::attrib_t attrib;
+	std::vector<tinyobj::shape_t> shapes;
+	std::vector<tinyobj::material_t> materials;
+	std::string warn, err;
+	if (!std::ifstream(model_path).good() || !tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, model_path)) {
+		return false;
+	}
+	const std::string path(model_path);
+	model.name = path.substr(path.find_last_of("/\\") + 1);
+	model.mesh.vertices.reserve(attrib.vertices.size() / 3);
+	for (size_t i = 0; i < attrib.vertices.size(); i += 3) {
+		model.mesh.vertices.push_back(Point(attrib.vertices[i], attrib.vertices[i + 1], attrib.vertices[i + 2]));
+	}
+	for (const auto& shape : shapes) {
+		for (const auto& index : shape.mesh.indices) {
+			model.mesh.indices.push_back(index.vertex_index);
+		}
+	}
+	return true;
+}
+
+namespace benchmark {
+
+	Model wavy_grid_model(int resolution) {
+		Model model;
+		model.name = "wavy_grid_" + std::to_string(resolution);
+		model.mesh.vertices.reserve(static_cast<size_t>(resolution + 1) * (resolution + 1));
+		for (int y = 0; y <= resolution; ++y) {
+			for (int x = 0; x <= resolution; ++x) {
+				const float u = 2.f * x / resolution - 1.f, v = 2.f * y / resolution - 1.f;
+				model.mesh.vertices.push_back(Point(u, v, 0.2f * sinf(4.f * u) * cosf(3.f * v)));
+			}
+		}
+		model.mesh.indices.reserve(static_cast<size_t>(resolution) * resolution * 6);
+		for (int y = 0; y < resolution; ++y) {
+			for (int x = 0; x < resolution; ++x) {
+				const int i = y * (resolution + 1) + x;
+				model.mesh.indices.insert(model.mesh.indices.end(), { i, i + 1, i + resolution + 1, i + 1, i + resolution + 2, i + resolution + 1 });
+			}
+		}
+		return model;
+	}
+
+	std::vector<Point> random_query_points(size_t count, float radius) {
+		std::mt19937 generator;
+		std::uniform_real_distribution<float> distribution(-1.f, 1.f);
+		std::vector<Point> points;
+		points.reserve(count);
+		while (points.size() < count) {
+			const Point p(distribution(generator), distribution(generator), distribution(generator));
+			if (p.length2() < 1.f) points.push_back(p * radius);
+		}
+		return points;
+	}
+
+} // namespace benchmark
@@ -0,0 +1,63 @@
+#pragma once
+#include <chrono>
+#include <string>
+#include <vector>
+#include <ClosestPointQuery.h>
+
+namespace benchmark {
+	using namespace geoutils;
+
+	// Same workload as the README benchmarks: 100,000 query points within a 1.5x unit sphere, 0.5 maximum query distance.
+	const size_t QUERY_POINT_COUNT = 100000;
+	const float QUERY_SPHERE_RADIUS = 1.5f;
+	const float QUERY_MAX_DISTANCE = 0.5f;
+
+	// A scoped timer class for profiling execution time.
+	// Timer starts once created and stops when it runs out of scope.
+	// Example:
+	//	Timer timer;
+	//	complex_function_call();
+	//	std::cout << "Time elapsed: " << timer.elapsed_ms() << "ms";
+	class Timer {
+	private:
+		std::chrono::steady_clock::time_point start;
+	public:
+		Timer() : start{ std::chrono::steady_clock::now() } {}
+		double elapsed_ms() const { return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() / 1000.0; }
+	};
+
+	// A named mesh loaded from an OBJ file, all shapes are merged into a single mesh.
+	struct Model {
+		std::string name;
+		Mesh mesh;
+		size_t triangle_count() const { return mesh.indices.size() / 3; }
+	};
+
+	// Resolution of the synthetic wavy grid that the suites about large meshes add to the models: 8M triangles,
+	// whose triangle packets and tree take about 350MB, far more than the last-level cache of current processors.
+	const int LARGE_MODEL_RESOLUTION = 2000;
+
+	// Generate a wavy grid model in the XY plane with 2 * resolution^2 triangles, spanning [-1, 1] on both axes as the tests do.
+	Model wavy_grid_model(int resolution);
+	// Generate deterministic random query points within a sphere of the given radius.
+	std::vector<Point> random_query_points(size_t count, float radius);
+	// Generate deterministic query points near random triangles of the mesh, see QueryOrder.cpp.
+	std::vector<Point> near_surface_query_points(const Mesh& mesh, size_t count, float offset);
+
+	// Benchmark suites. Each suite prints a markdown table with one row per model.
+	void tree_construction(const std::vector<Model>& models);
+	void parallel_construction(const std::vector<Model>& models);
+	void tree_query(const std::vector<Model>& models);
+	void leaf_size(const std::vector<Model>& models);
+	void triangle_kernel(const std::vector<Model>& models);
+	void vec3_backend(const std::vector<Model>& models);
+	void batch_query(const std::vector<Model>& models);
+	void query_order(const std::vector<Model>& models);
+	void traversal(const std::vector<Model>& models);
+	void grid_bake(const std::vector<Model>& models);
+	void distance_field(const std::vector<Model>& models);
+	void scene(const std::vector<Model>& models);
+	void vertex_storage(const std::vector<Model>& models);
+	void node_bounds(const std::vector<Model>& models);
+
+} // namespace benchmark
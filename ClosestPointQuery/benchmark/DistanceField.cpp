@@ -0,0 +1,59 @@
+#include <iostream>
+#include <DistanceField.h>
+#include "Benchmark.h"
+
+namespace benchmark {
+
+	// Tolerance and band of the distance fields, as fractions of the diagonal of the mesh.
+	const float FIELD_TOLERANCE = 1e-3f;
+	const float FIELD_BAND = 0.02f;
+	const size_t FIELD_MAX_DEPTHS[] = { 6, 8 };
+
+	// Build adaptive signed distance fields over the mesh and compare their queries near the surface against exact signed distance queries.
+	// Points whose cell is beyond the tolerance fall back to the exact query, the time includes them.
+	void distance_field(const std::vector<Model>& models) {
+		std::cout << "| Model Name | Triangles | Max Depth | Build Time | Cells | Memory | Interpolated | Exact Time | Field Time | Speedup | Max Error |\n";
+		std::cout << "| :--------- | :-------- | :-------- | :--------- | :---- | :----- | :----------- | :--------- | :--------- | :------ | :-------- |\n";
+		for (const Model& model : models) {
+			BuildOptions build_options;
+			build_options.pseudo_normals = true;
+			const ClosestPointQuery query(model.mesh, build_options);
+			const BoundingBox mesh_bound = query.bound();
+			const float diagonal = mesh_bound.min.distance(mesh_bound.max);
+			const Vec3 margin = (mesh_bound.max - mesh_bound.min) * 0.1f;
+			const BoundingBox bound{ mesh_bound.min - margin, mesh_bound.max + margin };
+			const std::vector<Point> query_points = near_surface_query_points(model.mesh, QUERY_POINT_COUNT, FIELD_BAND * 0.5f);
+
+			std::vector<float> expected(query_points.size());
+			Timer exact_timer;
+			for (size_t i = 0; i < query_points.size(); ++i) query.signed_distance(query_points[i], FLT_MAX, expected[i]);
+			const double exact_ms = exact_timer.elapsed_ms();
+
+			for (size_t max_depth : FIELD_MAX_DEPTHS) {
+				DistanceFieldOptions options;
+				options.signed_distance = true;
+				options.tolerance = FIELD_TOLERANCE * diagonal;
+				options.band = FIELD_BAND * diagonal;
+				options.max_depth = max_depth;
+				Timer build_timer;
+				const AdaptiveDistanceField field(query, bound, options);
+				const double build_ms = build_timer.elapsed_ms();
+
+				std::vector<float> distances(query_points.size());
+				Timer field_timer;
+				for (size_t i = 0; i < query_points.size(); ++i) distances[i] = field(query_points[i]);
+				const double field_ms = field_timer.elapsed_ms();
+				size_t interpolated_count = 0;
+				float max_error = 0.f, distance = 0.f;
+				for (size_t i = 0; i < query_points.size(); ++i) {
+					interpolated_count += field.interpolate(query_points[i], distance);
+					max_error = std::max(max_error, fabsf(distances[i] - expected[i]));
+				}
+				std::cout << "| " << model.name << " | " << model.triangle_count() << " | " << max_depth << " | " << build_ms / 1000.0 << "s | " << field.cell_count();
+				std::cout << " | " << field.memory_usage() / (1024.0 * 1024.0) << "MB | " << 100.0 * interpolated_count / query_points.size() << "%";
+				std::cout << " | " << exact_ms / 1000.0 << "s | " << field_ms / 1000.0 << "s | " << exact_ms / field_ms << "x | " << max_error / diagonal << " |\n";
+			}
+		}
+	}
+
+} // namespace benchmark
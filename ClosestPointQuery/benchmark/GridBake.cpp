@@ -0,0 +1,61 @@
+#include <iostream>
+#include "Benchmark.h"
+
+namespace benchmark {
+
+	// Number of samples along each axis of the baked grids.
+	const size_t GRID_RESOLUTION = 64;
+	// Width of the narrow band around the surface, in cells.
+	const float GRID_BAND_CELLS = 4.f;
+
+	// Sample the grid with query_batch on the points sorted along the Z-order curve, as a baseline. Return the time in milliseconds.
+	double run_batch_grid(const ClosestPointQuery& query, const BoundingBox& bound, float max_dist, std::vector<float>& distances) {
+		Timer timer;
+		const Vec3 cell_size = (bound.max - bound.min) * (1.f / GRID_RESOLUTION);
+		std::vector<Point> points(distances.size());
+		for (size_t i = 0; i < points.size(); ++i) {
+			points[i] = bound.min + cell_size * Vec3(i % GRID_RESOLUTION + 0.5f, i / GRID_RESOLUTION % GRID_RESOLUTION + 0.5f, i / GRID_RESOLUTION / GRID_RESOLUTION + 0.5f);
+		}
+		std::vector<uint8_t> found(points.size());
+		std::vector<Point> closest_points(points.size());
+		QueryOptions options;
+		options.order = QueryOrder::Morton;
+		query.query_batch(points, Span<const float>(&max_dist, 1), found, closest_points, options);
+		for (size_t i = 0; i < points.size(); ++i) distances[i] = found[i] ? points[i].distance(closest_points[i]) : max_dist;
+		return timer.elapsed_ms();
+	}
+	// Bake the grid with bake_grid. Return the time in milliseconds.
+	double run_bake_grid(const ClosestPointQuery& query, const BoundingBox& bound, float max_dist, std::vector<float>& distances) {
+		Timer timer;
+		GridOptions options;
+		options.max_dist = max_dist;
+		query.bake_grid(bound, GRID_RESOLUTION, GRID_RESOLUTION, GRID_RESOLUTION, distances, options);
+		return timer.elapsed_ms();
+	}
+
+	// Compare baking a dense distance grid over the mesh against querying every sample with query_batch, over the whole grid and a narrow band.
+	void grid_bake(const std::vector<Model>& models) {
+		std::cout << "| Model Name | Triangles | Samples | Band | query_batch | bake_grid | Speedup | Max Difference |\n";
+		std::cout << "| :--------- | :-------- | :------ | :--- | :---------- | :-------- | :------ | :------------- |\n";
+		for (const Model& model : models) {
+			const ClosestPointQuery query(model.mesh);
+			// A margin of 10% around the mesh on every side.
+			const BoundingBox mesh_bound = query.bound();
+			const Vec3 margin = (mesh_bound.max - mesh_bound.min) * 0.1f;
+			const BoundingBox bound{ mesh_bound.min - margin, mesh_bound.max + margin };
+			const float cell_size = (bound.max - bound.min).x() / GRID_RESOLUTION;
+			const float max_dists[] = { FLT_MAX, GRID_BAND_CELLS * cell_size };
+			for (float max_dist : max_dists) {
+				std::vector<float> batch_distances(GRID_RESOLUTION * GRID_RESOLUTION * GRID_RESOLUTION), baked_distances(batch_distances.size());
+				const double batch_ms = run_batch_grid(query, bound, max_dist, batch_distances);
+				const double bake_ms = run_bake_grid(query, bound, max_dist, baked_distances);
+				float max_difference = 0.f;
+				for (size_t i = 0; i < baked_distances.size(); ++i) max_difference = std::max(max_difference, fabsf(baked_distances[i] - batch_distances[i]));
+				std::cout << "| " << model.name << " | " << model.triangle_count() << " | " << baked_distances.size() << " | ";
+				if (max_dist == FLT_MAX) std::cout << "Full"; else std::cout << GRID_BAND_CELLS << " cells";
+				std::cout << " | " << batch_ms / 1000.0 << "s | " << bake_ms / 1000.0 << "s | " << batch_ms / bake_ms << "x | " << max_difference << " |\n";
+			}
+		}
+	}
+
+} // namespace benchmark
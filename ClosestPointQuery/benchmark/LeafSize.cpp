@@ -0,0 +1,35 @@
+#include <iostream>
+#include "Benchmark.h"
+
+namespace benchmark {
+
+	// Compare leaf bucket sizes, from one triangle per leaf up to 16, on construction time, memory and the query time of the resulting tree.
+	// Queries run on a single thread so that the tree layout is the only variable.
+	void leaf_size(const std::vector<Model>& models) {
+		const std::vector<Point> query_points = random_query_points(QUERY_POINT_COUNT, QUERY_SPHERE_RADIUS);
+		std::cout << "| Model Name | Triangles | Leaf Size | Construct Time | Memory | Query Time | Found |\n";
+		std::cout << "| :--------- | :-------- | :-------- | :------------- | :----- | :--------- | :---- |\n";
+		for (const Model& model : models) {
+			const size_t leaf_sizes[] = { 1, 2, 4, 8, 16 };
+			for (size_t size : leaf_sizes) {
+				BuildOptions options;
+				options.leaf_size = size;
+				Timer construct_timer;
+				const ClosestPointQuery query(model.mesh, options);
+				const double construct_ms = construct_timer.elapsed_ms();
+
+				Timer query_timer;
+				size_t found_count = 0;
+				for (const Point& p : query_points) {
+					Point closest_point;
+					found_count += query(p, QUERY_MAX_DISTANCE, closest_point);
+				}
+				const double query_ms = query_timer.elapsed_ms();
+
+				std::cout << "| " << model.name << " | " << model.triangle_count() << " | " << size;
+				std::cout << " | " << construct_ms / 1000.0 << "s | " << query.memory_usage() / (1024.0 * 1024.0) << "MB | " << query_ms / 1000.0 << "s | " << found_count << " |\n";
+			}
+		}
+	}
+
+} // namespace benchmark
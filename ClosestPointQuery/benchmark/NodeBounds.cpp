@@ -0,0 +1,79 @@
+#include <iostream>
+#include "Benchmark.h"
+
+namespace benchmark {
+
+	// Query a tree of triangle indices with every query point, shrinking the radius to the closest triangle vertex as in tree_query().
+	// Return the time in milliseconds, and the number of triangles visited.
+	double run_nearest_queries(const FrozenRStarTree<uint32_t, 64>& tree, const Mesh& mesh, const std::vector<Point>& query_points, size_t& visit_count) {
+		visit_count = 0;
+		Timer timer;
+		for (const Point& p : query_points) {
+			float best_distance2 = FLT_MAX;
+			tree.search_nearest(p, QUERY_MAX_DISTANCE, [&](uint32_t tri) -> float {
+				visit_count++;
+				for (size_t i = 0; i < 3; ++i) best_distance2 = std::min(best_distance2, p.distance2(mesh.vertices[mesh.indices[tri * 3 + i]]));
+				return best_distance2;
+			});
+		}
+		return timer.elapsed_ms();
+	}
+
+	// Compare float child boxes against 16-bit and 8-bit quantized ones: the memory of a tree with one triangle per leaf and the triangles it visits,
+	// then the time of ClosestPointQuery::query_batch with the same nodes.
+	// A synthetic model larger than the last level cache is added, where the smaller nodes matter most.
+	void node_bounds(const std::vector<Model>& models) {
+		std::cout << "| Model Name | Triangles | Node Bounds | Tree Memory | Visited | Tree Search | Query Time | Mismatches |\n";
+		std::cout << "| :--------- | :-------- | :---------- | :---------- | :------ | :---------- | :--------- | :--------- |\n";
+		const std::vector<Point> points = random_query_points(QUERY_POINT_COUNT, QUERY_SPHERE_RADIUS);
+		const NodeBounds formats[] = { NodeBounds::Float, NodeBounds::Quantized16, NodeBounds::Quantized8 };
+		const char* format_names[] = { "Float", "Quantized16", "Quantized8" };
+		const Model large_model = wavy_grid_model(LARGE_MODEL_RESOLUTION);
+		std::vector<const Model*> suite_models;
+		for (const Model& model : models) suite_models.push_back(&model);
+		suite_models.push_back(&large_model);
+		for (const Model* suite_model : suite_models) {
+			const Model& model = *suite_model;
+			const Mesh& mesh = model.mesh;
+			std::vector<std::pair<BoundingBox, uint32_t>> entries(model.triangle_count());
+			for (size_t i = 0; i < entries.size(); ++i) {
+				const Point p1 = mesh.vertices[mesh.indices[i * 3 + 0]];
+				const Point p2 = mesh.vertices[mesh.indices[i * 3 + 1]];
+				const Point p3 = mesh.vertices[mesh.indices[i * 3 + 2]];
+				entries[i] = { BoundingBox{ p1.min(p2).min(p3), p1.max(p2).max(p3) }, static_cast<uint32_t>(i) };
+			}
+			RStarTree<uint32_t, 64> tree;
+			tree.bulk_load(entries);
+
+			const float max_dist = QUERY_MAX_DISTANCE;
+			std::vector<uint8_t> float_found(points.size());
+			std::vector<Point> float_closest_points(points.size());
+			for (size_t f = 0; f < 3; ++f) {
+				const FrozenRStarTree<uint32_t, 64> frozen_tree(tree, formats[f]);
+				size_t visit_count = 0;
+				const double tree_ms = run_nearest_queries(frozen_tree, mesh, points, visit_count);
+
+				BuildOptions build_options;
+				build_options.node_bounds = formats[f];
+				const ClosestPointQuery query(mesh, build_options);
+				std::vector<uint8_t> found(points.size());
+				std::vector<Point> closest_points(points.size());
+				Timer timer;
+				query.query_batch(points, Span<const float>(&max_dist, 1), found, closest_points);
+				const double query_ms = timer.elapsed_ms();
+				if (f == 0) {
+					float_found = found;
+					float_closest_points = closest_points;
+				}
+				// The closest points may only differ between triangles at the same distance.
+				size_t mismatches = 0;
+				for (size_t i = 0; i < points.size(); ++i) {
+					if (found[i] != float_found[i] || (found[i] && points[i].distance2(closest_points[i]) != points[i].distance2(float_closest_points[i]))) ++mismatches;
+				}
+				std::cout << "| " << model.name << " | " << model.triangle_count() << " | " << format_names[f] << " | " << frozen_tree.memory_usage() / (1024.0 * 1024.0) << "MB";
+				std::cout << " | " << visit_count << " | " << tree_ms / 1000.0 << "s | " << query_ms / 1000.0 << "s | " << mismatches << " |\n";
+			}
+		}
+	}
+
+} // namespace benchmark
@@ -0,0 +1,31 @@
+#include <iostream>
+#include "Benchmark.h"
+
+namespace benchmark {
+
+	// Measure how the bulk-loading construction scales with the number of threads, from serial up to the hardware concurrency.
+	void parallel_construction(const std::vector<Model>& models) {
+		std::vector<size_t> thread_counts;
+		const size_t max_thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+		for (size_t thread_count = 1; thread_count < max_thread_count; thread_count *= 2) thread_counts.push_back(thread_count);
+		thread_counts.push_back(max_thread_count);
+
+		std::cout << "| Model Name | Triangles | Threads | Construct Time | Speedup |\n";
+		std::cout << "| :--------- | :-------- | :------ | :------------- | :------ |\n";
+		for (const Model& model : models) {
+			double serial_ms = 0.0;
+			for (size_t thread_count : thread_counts) {
+				ThreadPool thread_pool(thread_count);
+				BuildOptions options;
+				options.thread_pool = &thread_pool;
+				Timer construct_timer;
+				const ClosestPointQuery query(model.mesh, options);
+				const double construct_ms = construct_timer.elapsed_ms();
+				if (thread_count == 1) serial_ms = construct_ms;
+				std::cout << "| " << model.name << " | " << model.triangle_count() << " | " << thread_count;
+				std::cout << " | " << construct_ms / 1000.0 << "s | " << serial_ms / construct_ms << "x |\n";
+			}
+		}
+	}
+
+} // namespace benchmark
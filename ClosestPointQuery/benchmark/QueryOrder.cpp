@@ -0,0 +1,67 @@
+#include <iostream>
+#include <random>
+#include "Benchmark.h"
+
+namespace benchmark {
+
+	// Generate deterministic query points on random triangles of the mesh, offset along the normal by up to the given fraction of the mesh size.
+	std::vector<Point> near_surface_query_points(const Mesh& mesh, size_t count, float offset) {
+		BoundingBox bound;
+		for (const Point& p : mesh.vertices) bound.enlarge(BoundingBox{ p, p });
+		const float max_offset = offset * bound.min.distance(bound.max);
+		std::mt19937 generator;
+		std::uniform_int_distribution<size_t> triangle_distribution(0, mesh.indices.size() / 3 - 1);
+		std::uniform_real_distribution<float> distribution(0.f, 1.f);
+		std::vector<Point> points;
+		points.reserve(count);
+		while (points.size() < count) {
+			const size_t triangle = triangle_distribution(generator);
+			const Point& a = mesh.vertices[mesh.indices[triangle * 3]];
+			const Point& b = mesh.vertices[mesh.indices[triangle * 3 + 1]];
+			const Point& c = mesh.vertices[mesh.indices[triangle * 3 + 2]];
+			const Vec3 normal = (b - a).cross(c - a);
+			if (normal.nearly_zero()) continue;
+			float u = distribution(generator), v = distribution(generator);
+			if (u + v > 1.f) { u = 1.f - u; v = 1.f - v; }
+			points.push_back(a + (b - a) * u + (c - a) * v + normal.normalize() * ((distribution(generator) * 2.f - 1.f) * max_offset));
+		}
+		return points;
+	}
+
+	// Compare the orders of query_batch on every thread of the machine, on random points in a sphere and on points near the surface.
+	// The time includes sorting the query points.
+	void query_order(const std::vector<Model>& models) {
+		const QueryOrder orders[] = { QueryOrder::Input, QueryOrder::Morton, QueryOrder::Hilbert };
+		const char* order_names[] = { "Input", "Morton", "Hilbert" };
+		const std::vector<Point> sphere_points = random_query_points(QUERY_POINT_COUNT, QUERY_SPHERE_RADIUS);
+
+		std::cout << "| Model Name | Triangles | Workload | Order | Query Time | Speedup | Found |\n";
+		std::cout << "| :--------- | :-------- | :------- | :---- | :--------- | :------ | :---- |\n";
+		for (const Model& model : models) {
+			const ClosestPointQuery query(model.mesh);
+			const std::vector<Point> surface_points = near_surface_query_points(model.mesh, QUERY_POINT_COUNT, 0.01f);
+			const std::vector<Point>* workloads[] = { &sphere_points, &surface_points };
+			const char* workload_names[] = { "Sphere", "Near surface" };
+			for (size_t w = 0; w < 2; ++w) {
+				const std::vector<Point>& query_points = *workloads[w];
+				std::vector<uint8_t> found(query_points.size());
+				std::vector<Point> closest_points(query_points.size());
+				const float max_dist = QUERY_MAX_DISTANCE;
+				double input_ms = 0.0;
+				for (size_t o = 0; o < 3; ++o) {
+					QueryOptions options;
+					options.order = orders[o];
+					Timer timer;
+					query.query_batch(query_points, Span<const float>(&max_dist, 1), found, closest_points, options);
+					const double ms = timer.elapsed_ms();
+					if (orders[o] == QueryOrder::Input) input_ms = ms;
+					size_t found_count = 0;
+					for (uint8_t f : found) found_count += f;
+					std::cout << "| " << model.name << " | " << model.triangle_count() << " | " << workload_names[w] << " | " << order_names[o];
+					std::cout << " | " << ms / 1000.0 << "s | " << input_ms / ms << "x | " << found_count << " |\n";
+				}
+			}
+		}
+	}
+
+} // namespace benchmark
@@ -0,0 +1,85 @@
+#include <iostream>
+#include <SceneClosestPointQuery.h>
+#include "Benchmark.h"
+
+namespace benchmark {
+
+	// Number of copies or instances of the model along each axis of the scene.
+	const size_t SCENE_GRID_SIZES[] = { 2, 4 };
+
+	// Lay out instances of the mesh on a grid, after scaling it down to fit a cell of the unit sphere's bounding box.
+	std::vector<MeshInstance> grid_instances(Mesh& mesh, size_t grid_size) {
+		BoundingBox bound;
+		for (const Point& v : mesh.vertices) bound.enlarge(BoundingBox{ v, v });
+		const Vec3 extent = bound.max - bound.min;
+		const float scale = 2.f / grid_size / std::max(extent.x(), std::max(extent.y(), extent.z()));
+		for (Point& v : mesh.vertices) v = (v - bound.min) * scale;
+		std::vector<MeshInstance> instances(grid_size * grid_size * grid_size);
+		for (size_t i = 0; i < instances.size(); ++i) {
+			const Vec3 cell(float(i % grid_size), float(i / grid_size % grid_size), float(i / grid_size / grid_size));
+			instances[i].transform.translation = Point(-1.f, -1.f, -1.f) + cell * (2.f / grid_size);
+		}
+		return instances;
+	}
+	// Copy the mesh once per instance, transformed into the scene.
+	std::vector<Mesh> instance_copies(const Mesh& mesh, const std::vector<MeshInstance>& instances) {
+		std::vector<Mesh> meshes(instances.size(), mesh);
+		for (size_t i = 0; i < instances.size(); ++i) {
+			for (Point& v : meshes[i].vertices) v = instances[i].transform.apply(v);
+		}
+		return meshes;
+	}
+
+	// Compare one scene query over the top-level tree against querying every mesh in turn and keeping the closest point,
+	// then a scene of instances of the mesh against a scene of transformed copies.
+	void scene(const std::vector<Model>& models) {
+		std::cout << "| Model Name | Meshes | Triangles | Query Points | Per Mesh | Scene | Speedup | Instanced | Copies Memory | Instanced Memory | Mismatches |\n";
+		std::cout << "| :--------- | :----- | :-------- | :----------- | :------- | :---- | :------ | :-------- | :------------ | :--------------- | :--------- |\n";
+		const std::vector<Point> points = random_query_points(QUERY_POINT_COUNT, QUERY_SPHERE_RADIUS);
+		for (const Model& model : models) {
+			for (size_t grid_size : SCENE_GRID_SIZES) {
+				std::vector<Mesh> mesh{ model.mesh };
+				const std::vector<MeshInstance> instances = grid_instances(mesh[0], grid_size);
+				const std::vector<Mesh> meshes = instance_copies(mesh[0], instances);
+				const SceneClosestPointQuery scene(meshes);
+				const float max_dist = QUERY_MAX_DISTANCE;
+
+				// The closest point of every mesh is searched within the best distance found so far, as the scene does without the top-level tree.
+				std::vector<float> mesh_distance2(points.size(), FLT_MAX);
+				Timer mesh_timer;
+				ThreadPool::global().parallel_for_chunked(points.size(), 128, [&](size_t begin, size_t end) {
+					for (size_t i = begin; i < end; ++i) {
+						for (size_t mesh = 0; mesh < scene.mesh_count(); ++mesh) {
+							QueryResult result;
+							const float mesh_max_dist = mesh_distance2[i] == FLT_MAX ? max_dist : sqrtf(mesh_distance2[i]);
+							if (scene.mesh_query(mesh)(points[i], mesh_max_dist, result)) mesh_distance2[i] = std::min(mesh_distance2[i], result.distance2);
+						}
+					}
+				});
+				const double mesh_ms = mesh_timer.elapsed_ms();
+
+				std::vector<uint8_t> found(points.size()), instanced_found(points.size());
+				std::vector<SceneQueryResult> results(points.size()), instanced_results(points.size());
+				Timer scene_timer;
+				scene.query_batch(points, Span<const float>(&max_dist, 1), found, results);
+				const double scene_ms = scene_timer.elapsed_ms();
+
+				const SceneClosestPointQuery instanced_scene(mesh, instances);
+				Timer instanced_timer;
+				instanced_scene.query_batch(points, Span<const float>(&max_dist, 1), instanced_found, instanced_results);
+				const double instanced_ms = instanced_timer.elapsed_ms();
+
+				// The transforms are pure translations here, the instanced distances may only differ by rounding.
+				size_t mismatches = 0;
+				for (size_t i = 0; i < points.size(); ++i) {
+					if ((found[i] != 0) != (mesh_distance2[i] != FLT_MAX) || (found[i] && results[i].distance2 != mesh_distance2[i])) ++mismatches;
+					else if ((instanced_found[i] != 0) != (found[i] != 0) || (found[i] && fabsf(sqrtf(instanced_results[i].distance2) - sqrtf(results[i].distance2)) > 1e-5f)) ++mismatches;
+				}
+				std::cout << "| " << model.name << " | " << meshes.size() << " | " << model.triangle_count() * meshes.size() << " | " << points.size();
+				std::cout << " | " << mesh_ms / 1000.0 << "s | " << scene_ms / 1000.0 << "s | " << mesh_ms / scene_ms << "x | " << instanced_ms / 1000.0 << "s";
+				std::cout << " | " << scene.memory_usage() / 1e6 << "MB | " << instanced_scene.memory_usage() / 1e6 << "MB | " << mismatches << " |\n";
+			}
+		}
+	}
+
+} // namespace benchmark
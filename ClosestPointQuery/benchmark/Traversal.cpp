@@ -0,0 +1,74 @@
+#include <iostream>
+#include "Benchmark.h"
+
+namespace benchmark {
+
+	// Generate query points on a regular grid over the bounding box of the mesh, enlarged by the given fraction on every side.
+	std::vector<Point> grid_query_points(const Mesh& mesh, size_t count, float margin) {
+		BoundingBox bound;
+		for (const Point& p : mesh.vertices) bound.enlarge(BoundingBox{ p, p });
+		const Vec3 extent = bound.max - bound.min;
+		const Point min = bound.min - extent * margin;
+		const Vec3 size = extent * (1.f + 2.f * margin);
+		const size_t resolution = static_cast<size_t>(ceilf(cbrtf(static_cast<float>(count))));
+		std::vector<Point> points;
+		points.reserve(resolution * resolution * resolution);
+		for (size_t x = 0; x < resolution; ++x) {
+			for (size_t y = 0; y < resolution; ++y) {
+				for (size_t z = 0; z < resolution; ++z) {
+					points.push_back(min + size * Vec3((x + 0.5f) / resolution, (y + 0.5f) / resolution, (z + 0.5f) / resolution));
+				}
+			}
+		}
+		return points;
+	}
+
+	// Compare the ways of walking the tree against one query point at a time, on a single thread.
+	// The grid samples are generated in scanline order, the other workloads are sorted along the Z-order curve to make the packets coherent,
+	// except for the unsorted random points which leave the caches cold for every query.
+	// A synthetic wavy grid larger than the last-level cache follows the models, where the unsorted queries miss the cache the most.
+	void traversal(const std::vector<Model>& models) {
+		const std::vector<Point> sphere_points = random_query_points(QUERY_POINT_COUNT, QUERY_SPHERE_RADIUS);
+		ThreadPool serial_pool(1);
+		const Model large_model = wavy_grid_model(LARGE_MODEL_RESOLUTION);
+		std::vector<const Model*> suite_models;
+		for (const Model& model : models) suite_models.push_back(&model);
+		suite_models.push_back(&large_model);
+
+		std::cout << "| Model Name | Triangles | Workload | Traversal | Query Time | Speedup | Found |\n";
+		std::cout << "| :--------- | :-------- | :------- | :-------- | :--------- | :------ | :---- |\n";
+		for (const Model* suite_model : suite_models) {
+			const Model& model = *suite_model;
+			const ClosestPointQuery query(model.mesh);
+			const std::vector<Point> grid_points = grid_query_points(model.mesh, QUERY_POINT_COUNT, 0.1f);
+			const std::vector<Point> surface_points = near_surface_query_points(model.mesh, QUERY_POINT_COUNT, 0.01f);
+			const std::vector<Point>* workloads[] = { &grid_points, &surface_points, &sphere_points, &sphere_points };
+			const char* workload_names[] = { "Grid", "Near surface", "Sphere", "Sphere, unsorted" };
+			const QueryOrder workload_orders[] = { QueryOrder::Input, QueryOrder::Morton, QueryOrder::Morton, QueryOrder::Input };
+			for (size_t w = 0; w < 4; ++w) {
+				const std::vector<Point>& query_points = *workloads[w];
+				std::vector<uint8_t> found(query_points.size());
+				std::vector<Point> closest_points(query_points.size());
+				const float max_dist = QUERY_MAX_DISTANCE;
+				double single_ms = 0.0;
+				const QueryTraversal traversals[] = { QueryTraversal::Single, QueryTraversal::Packet };
+				const char* traversal_names[] = { "Single", "Packet" };
+				for (size_t t = 0; t < 2; ++t) {
+					QueryOptions options;
+					options.thread_pool = &serial_pool;
+					options.order = workload_orders[w];
+					options.traversal = traversals[t];
+					Timer timer;
+					query.query_batch(query_points, Span<const float>(&max_dist, 1), found, closest_points, options);
+					const double ms = timer.elapsed_ms();
+					if (t == 0) single_ms = ms;
+					size_t found_count = 0;
+					for (uint8_t f : found) found_count += f;
+					std::cout << "| " << model.name << " | " << model.triangle_count() << " | " << workload_names[w] << " | " << traversal_names[t];
+					std::cout << " | " << ms / 1000.0 << "s | " << single_ms / ms << "x | " << found_count << " |\n";
+				}
+			}
+		}
+	}
+
+} // namespace benchmark
@@ -0,0 +1,35 @@
+#include <iostream>
+#include "Benchmark.h"
+
+namespace benchmark {
+
+	// Compare the STR bulk-loading against the incremental R* insertion, both on construction time and the query time of the resulting tree.
+	// Queries run on a single thread so that the tree quality is the only variable.
+	void tree_construction(const std::vector<Model>& models) {
+		const std::vector<Point> query_points = random_query_points(QUERY_POINT_COUNT, QUERY_SPHERE_RADIUS);
+		std::cout << "| Model Name | Triangles | Construction | Construct Time | Memory | Query Time | Found |\n";
+		std::cout << "| :--------- | :-------- | :----------- | :------------- | :----- | :--------- | :---- |\n";
+		for (const Model& model : models) {
+			const TreeConstruction constructions[] = { TreeConstruction::Incremental, TreeConstruction::BulkLoad };
+			for (TreeConstruction construction : constructions) {
+				BuildOptions options;
+				options.construction = construction;
+				Timer construct_timer;
+				const ClosestPointQuery query(model.mesh, options);
+				const double construct_ms = construct_timer.elapsed_ms();
+
+				Timer query_timer;
+				size_t found_count = 0;
+				for (const Point& p : query_points) {
+					Point closest_point;
+					found_count += query(p, QUERY_MAX_DISTANCE, closest_point);
+				}
+				const double query_ms = query_timer.elapsed_ms();
+
+				std::cout << "| " << model.name << " | " << model.triangle_count() << " | " << (construction == TreeConstruction::BulkLoad ? "STR bulk-load" : "R* insertion");
+				std::cout << " | " << construct_ms / 1000.0 << "s | " << query.memory_usage() / (1024.0 * 1024.0) << "MB | " << query_ms / 1000.0 << "s | " << found_count << " |\n";
+			}
+		}
+	}
+
+} // namespace benchmark
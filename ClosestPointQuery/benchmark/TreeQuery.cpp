@@ -0,0 +1,60 @@
+#include <iostream>
+#include "Benchmark.h"
+
+namespace benchmark {
+
+	// Query a tree of triangle indices with every query point and return the total time in milliseconds.
+	// The radius search only counts the candidates, the nearest search shrinks the radius to the closest triangle vertex,
+	// so both measure the traversal rather than the point-triangle distance.
+	template<typename Tree>
+	double run_tree_queries(const Tree& tree, const Mesh& mesh, const std::vector<Point>& query_points, bool nearest, size_t& visit_count) {
+		visit_count = 0;
+		Timer timer;
+		for (const Point& p : query_points) {
+			if (nearest) {
+				float best_distance2 = FLT_MAX;
+				tree.search_nearest(p, QUERY_MAX_DISTANCE, [&](size_t tri) -> float {
+					visit_count++;
+					for (size_t i = 0; i < 3; ++i) best_distance2 = std::min(best_distance2, p.distance2(mesh.vertices[mesh.indices[tri * 3 + i]]));
+					return best_distance2;
+				});
+			}
+			else {
+				tree.search_radius(p, QUERY_MAX_DISTANCE, [&](size_t) { visit_count++; return true; });
+			}
+		}
+		return timer.elapsed_ms();
+	}
+
+	// Compare the query throughput of the pointer-based RStarTree against its flattened FrozenRStarTree, on the same bulk-loaded tree.
+	void tree_query(const std::vector<Model>& models) {
+		const std::vector<Point> query_points = random_query_points(QUERY_POINT_COUNT, QUERY_SPHERE_RADIUS);
+		std::cout << "| Model Name | Triangles | Search | RStarTree | FrozenRStarTree | Speedup | Visited |\n";
+		std::cout << "| :--------- | :-------- | :----- | :-------- | :-------------- | :------ | :------ |\n";
+		for (const Model& model : models) {
+			const Mesh& mesh = model.mesh;
+			std::vector<std::pair<BoundingBox, size_t>> entries(model.triangle_count());
+			for (size_t i = 0; i < entries.size(); ++i) {
+				const Point& p1 = mesh.vertices[mesh.indices[i * 3 + 0]];
+				const Point& p2 = mesh.vertices[mesh.indices[i * 3 + 1]];
+				const Point& p3 = mesh.vertices[mesh.indices[i * 3 + 2]];
+				entries[i] = { BoundingBox{ p1.min(p2).min(p3), p1.max(p2).max(p3) }, i };
+			}
+			RStarTree<size_t, 64> tree;
+			tree.bulk_load(entries);
+			const FrozenRStarTree<size_t, 64> frozen_tree(tree);
+
+			const bool searches[] = { false, true };
+			for (bool nearest : searches) {
+				size_t visit_count = 0, frozen_visit_count = 0;
+				const double tree_ms = run_tree_queries(tree, mesh, query_points, nearest, visit_count);
+				const double frozen_ms = run_tree_queries(frozen_tree, mesh, query_points, nearest, frozen_visit_count);
+				std::cout << "| " << model.name << " | " << model.triangle_count() << " | " << (nearest ? "search_nearest" : "search_radius");
+				std::cout << " | " << tree_ms / 1000.0 << "s | " << frozen_ms / 1000.0 << "s | " << tree_ms / frozen_ms << "x | " << visit_count;
+				if (frozen_visit_count != visit_count) std::cout << " (" << frozen_visit_count << ")";
+				std::cout << " |\n";
+			}
+		}
+	}
+
+} // namespace benchmark
@@ -0,0 +1,110 @@
+#include <iostream>
+#include <memory>
+#include "Benchmark.h"
+
+namespace benchmark {
+
+	// Number of consecutive mesh triangles tested against each query point, roughly the candidates of a nearest query.
+	const size_t KERNEL_TRIANGLE_COUNT = 64;
+
+	// Test every query point against a window of triangles with the scalar kernel, return the total time in milliseconds.
+	double run_scalar_kernel(const Mesh& mesh, const std::vector<Point>& query_points, double& distance_sum) {
+		const size_t window_count = mesh.indices.size() / 3 / KERNEL_TRIANGLE_COUNT;
+		distance_sum = 0.0;
+		Timer timer;
+		for (size_t q = 0; q < query_points.size(); ++q) {
+			const size_t first = q % window_count * KERNEL_TRIANGLE_COUNT;
+			float shortest_distance = FLT_MAX;
+			Point closest_point;
+			for (size_t i = first; i < first + KERNEL_TRIANGLE_COUNT; ++i) {
+				const Point triangle[3] = { mesh.vertices[mesh.indices[i * 3]], mesh.vertices[mesh.indices[i * 3 + 1]], mesh.vertices[mesh.indices[i * 3 + 2]] };
+				closest_point_on_triangle(query_points[q], triangle, shortest_distance, closest_point);
+			}
+			distance_sum += shortest_distance;
+		}
+		return timer.elapsed_ms();
+	}
+	// Same as run_scalar_kernel, with the triangles gathered into packets beforehand.
+	template<typename PACKET>
+	double run_packet_kernel(const Mesh& mesh, const std::vector<Point>& query_points, double& distance_sum) {
+		const size_t window_count = mesh.indices.size() / 3 / KERNEL_TRIANGLE_COUNT;
+		const size_t packets_per_window = KERNEL_TRIANGLE_COUNT / PACKET::WIDTH;
+		math::AlignedArray<PACKET> packets(window_count * packets_per_window);
+		for (size_t i = 0; i < window_count * KERNEL_TRIANGLE_COUNT; ++i) {
+			packets[i / PACKET::WIDTH].set(i % PACKET::WIDTH, mesh.vertices[mesh.indices[i * 3]], mesh.vertices[mesh.indices[i * 3 + 1]], mesh.vertices[mesh.indices[i * 3 + 2]]);
+		}
+		distance_sum = 0.0;
+		Timer timer;
+		for (size_t q = 0; q < query_points.size(); ++q) {
+			const size_t first = q % window_count * packets_per_window;
+			float shortest_distance = FLT_MAX;
+			Point closest_point;
+			for (size_t i = first; i < first + packets_per_window; ++i) {
+				packets[i].closest_point(query_points[q], shortest_distance, closest_point);
+			}
+			distance_sum += shortest_distance;
+		}
+		return timer.elapsed_ms();
+	}
+
+	// Print one row of the kernel table, timed against the scalar kernel.
+	template<typename PACKET>
+	void print_packet_kernel(const Model& model, const std::vector<Point>& query_points, const char* name, double scalar_ms) {
+		double distance_sum = 0.0;
+		const double ms = run_packet_kernel<PACKET>(model.mesh, query_points, distance_sum);
+		std::cout << "| " << model.name << " | " << query_points.size() * KERNEL_TRIANGLE_COUNT << " | " << name << " | " << ms / 1000.0 << "s | " << scalar_ms / ms << "x | " << distance_sum << " |\n";
+	}
+
+	// Compare the scalar winding-order kernel against the packet kernels, 4-wide and 8-wide when compiled with AVX.
+	// Every query point is tested against a window of consecutive triangles of the model, without the tree.
+	// Then compare the triangle layouts of ClosestPointQuery end-to-end, on memory and the query time on a single thread.
+	void triangle_kernel(const std::vector<Model>& models) {
+		const std::vector<Point> query_points = random_query_points(QUERY_POINT_COUNT, QUERY_SPHERE_RADIUS);
+		std::cout << "| Model Name | Triangle Tests | Kernel | Time | Speedup | Distance Sum |\n";
+		std::cout << "| :--------- | :------------- | :----- | :--- | :------ | :----------- |\n";
+		for (const Model& model : models) {
+			if (model.triangle_count() < KERNEL_TRIANGLE_COUNT) continue;
+			double distance_sum = 0.0;
+			const double scalar_ms = run_scalar_kernel(model.mesh, query_points, distance_sum);
+			std::cout << "| " << model.name << " | " << query_points.size() * KERNEL_TRIANGLE_COUNT << " | Scalar | " << scalar_ms / 1000.0 << "s | 1x | " << distance_sum << " |\n";
+			print_packet_kernel<TrianglePacket<math::Float4>>(model, query_points, "Vertices Float4", scalar_ms);
+			print_packet_kernel<PrecomputedTrianglePacket<math::Float4>>(model, query_points, "Precomputed Float4", scalar_ms);
+			print_packet_kernel<JonesTrianglePacket<math::Float4>>(model, query_points, "Jones Float4", scalar_ms);
+#if defined(MATH_BACKEND_AVX)
+			print_packet_kernel<TrianglePacket<math::Float8>>(model, query_points, "Vertices Float8", scalar_ms);
+			print_packet_kernel<PrecomputedTrianglePacket<math::Float8>>(model, query_points, "Precomputed Float8", scalar_ms);
+			print_packet_kernel<JonesTrianglePacket<math::Float8>>(model, query_points, "Jones Float8", scalar_ms);
+#endif
+		}
+
+		std::cout << "\n| Model Name | Triangles | Kernel | Construct Time | Memory | Query Time | Found |\n";
+		std::cout << "| :--------- | :-------- | :----- | :------------- | :----- | :--------- | :---- |\n";
+		for (const Model& model : models) {
+			// The indexed layout is run twice, referencing the mesh of the model and owning a copy of it, whose memory is then included.
+			const TriangleKernel kernels[] = { TriangleKernel::Vertices, TriangleKernel::Precomputed, TriangleKernel::Jones, TriangleKernel::Indexed, TriangleKernel::Indexed };
+			const char* kernel_names[] = { "Vertices", "Precomputed", "Jones", "Indexed", "Indexed (owned mesh)" };
+			for (size_t k = 0; k < 5; ++k) {
+				const TriangleKernel kernel = kernels[k];
+				BuildOptions options;
+				options.kernel = kernel;
+				Mesh mesh_copy = model.mesh;
+				Timer construct_timer;
+				const std::unique_ptr<const ClosestPointQuery> query_ptr(k == 4 ? new ClosestPointQuery(std::move(mesh_copy), options) : new ClosestPointQuery(model.mesh, options));
+				const ClosestPointQuery& query = *query_ptr;
+				const double construct_ms = construct_timer.elapsed_ms();
+
+				Timer query_timer;
+				size_t found_count = 0;
+				for (const Point& p : query_points) {
+					Point closest_point;
+					found_count += query(p, QUERY_MAX_DISTANCE, closest_point);
+				}
+				const double query_ms = query_timer.elapsed_ms();
+
+				std::cout << "| " << model.name << " | " << model.triangle_count() << " | " << kernel_names[k];
+				std::cout << " | " << construct_ms / 1000.0 << "s | " << query.memory_usage() / (1024.0 * 1024.0) << "MB | " << query_ms / 1000.0 << "s | " << found_count << " |\n";
+			}
+		}
+	}
+
+} // namespace benchmark
@@ -0,0 +1,111 @@
+#include <iostream>
+#include "Benchmark.h"
+
+namespace benchmark {
+
+	// Number of operations timed per model and operation, the vertices are looped over until it's reached.
+	const size_t VEC3_OPERATION_COUNT = 10000000;
+
+#if defined(MATH_HAS_SSE4)
+	// The SSE implementation before the backends were split, horizontal operations done with _mm_dp_ps.
+	// Kept here as a reference only.
+	class alignas(16) LegacyVec3 {
+	private:
+		__m128 _data;
+	public:
+		LegacyVec3() : _data{ _mm_setzero_ps() } {}
+		LegacyVec3(float x, float y, float z) : _data{ _mm_setr_ps(x, y, z, 0.f) } {}
+		LegacyVec3 operator+(const LegacyVec3& other) const { return LegacyVec3(_mm_add_ps(_data, other._data)); }
+		LegacyVec3 operator*(float scalar) const { return LegacyVec3(_mm_mul_ps(_data, _mm_set_ps1(scalar))); }
+		float x() const { alignas(16) float lanes[4]; _mm_store_ps(lanes, _data); return lanes[0]; }
+		float y() const { alignas(16) float lanes[4]; _mm_store_ps(lanes, _data); return lanes[1]; }
+		float z() const { alignas(16) float lanes[4]; _mm_store_ps(lanes, _data); return lanes[2]; }
+		float dot(const LegacyVec3& other) const { return _mm_cvtss_f32(_mm_dp_ps(_data, other._data, 0x71)); }
+		LegacyVec3 min(const LegacyVec3& other) const { return LegacyVec3(_mm_min_ps(_data, other._data)); }
+		LegacyVec3 max(const LegacyVec3& other) const { return LegacyVec3(_mm_max_ps(_data, other._data)); }
+		LegacyVec3 normalize() const {
+			const __m128 length = _mm_sqrt_ps(_mm_dp_ps(_data, _data, 0x77));
+			return LegacyVec3(_mm_mul_ps(_data, _mm_div_ps(_mm_set_ps1(1.0f), length)));
+		}
+		LegacyVec3 cross(const LegacyVec3& other) const {
+			const __m128 tmp0 = _mm_shuffle_ps(_data, _data, _MM_SHUFFLE(3, 0, 2, 1));
+			const __m128 tmp1 = _mm_shuffle_ps(other._data, other._data, _MM_SHUFFLE(3, 1, 0, 2));
+			const __m128 tmp2 = _mm_shuffle_ps(_data, _data, _MM_SHUFFLE(3, 1, 0, 2));
+			const __m128 tmp3 = _mm_shuffle_ps(other._data, other._data, _MM_SHUFFLE(3, 0, 2, 1));
+			return LegacyVec3(_mm_sub_ps(_mm_mul_ps(tmp0, tmp1), _mm_mul_ps(tmp2, tmp3)));
+		}
+	private:
+		LegacyVec3(const __m128& _data) : _data{ _data } {}
+	};
+#endif
+
+	// The operations being timed, each combines two consecutive vertices into a vector that is accumulated.
+	struct DotOperation {
+		template<typename VEC3> VEC3 operator()(const VEC3& a, const VEC3& b) const { return a * a.dot(b); }
+	};
+	struct CrossOperation {
+		template<typename VEC3> VEC3 operator()(const VEC3& a, const VEC3& b) const { return a.cross(b); }
+	};
+	struct NormalizeOperation {
+		template<typename VEC3> VEC3 operator()(const VEC3& a, const VEC3&) const { return a.normalize(); }
+	};
+	struct MinMaxOperation {
+		template<typename VEC3> VEC3 operator()(const VEC3& a, const VEC3& b) const { return a.min(b) + a.max(b); }
+	};
+
+	// Apply the operation on consecutive vertices VEC3_OPERATION_COUNT times, return the time in milliseconds.
+	// The accumulated result is added to checksum so that the loop can't be optimized away.
+	template<typename VEC3, typename OPERATION>
+	double run_vec3_operation(const std::vector<VEC3>& vertices, OPERATION operation, double& checksum) {
+		VEC3 sum;
+		Timer timer;
+		for (size_t n = 0, i = 0; n < VEC3_OPERATION_COUNT; ++n) {
+			const size_t j = i + 1 < vertices.size() ? i + 1 : 0;
+			sum = sum + operation(vertices[i], vertices[j]);
+			i = j;
+		}
+		const double ms = timer.elapsed_ms();
+		checksum += sum.x() + sum.y() + sum.z();
+		return ms;
+	}
+
+	// Print one row of the backend table, with the time of every operation in nanoseconds.
+	template<typename VEC3>
+	void print_vec3_backend(const Model& model, const char* backend_name) {
+		std::vector<VEC3> vertices;
+		vertices.reserve(model.mesh.vertices.size());
+		for (const Point& p : model.mesh.vertices) vertices.push_back(VEC3(p.x(), p.y(), p.z()));
+		if (vertices.size() < 2) return;
+
+		double checksum = 0.0;
+		const double ns = 1e6 / VEC3_OPERATION_COUNT;
+		std::cout << "| " << model.name << " | " << backend_name;
+		std::cout << " | " << run_vec3_operation(vertices, DotOperation(), checksum) * ns << "ns";
+		std::cout << " | " << run_vec3_operation(vertices, CrossOperation(), checksum) * ns << "ns";
+		std::cout << " | " << run_vec3_operation(vertices, NormalizeOperation(), checksum) * ns << "ns";
+		std::cout << " | " << run_vec3_operation(vertices, MinMaxOperation(), checksum) * ns << "ns";
+		std::cout << " | " << checksum << " |\n";
+	}
+
+	// Compare the Vec3 backends available on the target on the common operations, the selected one is math::Vec3.
+	// The checksums may differ in the last digits, the backends round normalize and fused multiply-adds differently.
+	void vec3_backend(const std::vector<Model>& models) {
+		std::cout << "| Model Name | Backend | Dot | Cross | Normalize | Min/Max | Checksum |\n";
+		std::cout << "| :--------- | :------ | :-- | :---- | :-------- | :------ | :------- |\n";
+		for (const Model& model : models) {
+			print_vec3_backend<math::ScalarVec3>(model, "Scalar");
+#if defined(MATH_HAS_SSE4)
+			print_vec3_backend<LegacyVec3>(model, "SSE4 (_mm_dp_ps)");
+#if defined(MATH_HAS_FMA)
+			print_vec3_backend<math::SseVec3>(model, "SSE4 + FMA");
+#else
+			print_vec3_backend<math::SseVec3>(model, "SSE4");
+#endif
+#endif
+#if defined(MATH_HAS_NEON)
+			print_vec3_backend<math::NeonVec3>(model, "NEON");
+#endif
+		}
+	}
+
+} // namespace benchmark
@@ -0,0 +1,75 @@
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include "Benchmark.h"
+
+namespace benchmark {
+
+	// Number of passes over the vertices or triangles of a model, so that small models are timed long enough.
+	const size_t VERTEX_STORAGE_PASSES = 20;
+
+	// Bound every vertex of the array, streaming it from start to end. Return the time in milliseconds.
+	template<typename VERTEX>
+	double run_vertex_stream(const std::vector<VERTEX>& vertices, double& checksum) {
+		Timer timer;
+		BoundingBox bound;
+		for (size_t pass = 0; pass < VERTEX_STORAGE_PASSES; ++pass) {
+			for (const VERTEX& vertex : vertices) {
+				const Point p = vertex;
+				bound.min = bound.min.min(p);
+				bound.max = bound.max.max(p);
+			}
+		}
+		const double ms = timer.elapsed_ms();
+		checksum += bound.max.x() - bound.min.x();
+		return ms;
+	}
+	// Sum the areas of the triangles in the given order, gathering their vertices through the indices. Return the time in milliseconds.
+	template<typename VERTEX>
+	double run_vertex_gather(const std::vector<VERTEX>& vertices, const std::vector<int>& indices, const std::vector<uint32_t>& order, double& checksum) {
+		Timer timer;
+		float area = 0.f;
+		for (size_t pass = 0; pass < VERTEX_STORAGE_PASSES; ++pass) {
+			for (uint32_t triangle : order) {
+				const Point p1 = vertices[indices[triangle * 3]], p2 = vertices[indices[triangle * 3 + 1]], p3 = vertices[indices[triangle * 3 + 2]];
+				area += (p2 - p1).cross(p3 - p1).length();
+			}
+		}
+		const double ms = timer.elapsed_ms();
+		checksum += area;
+		return ms;
+	}
+
+	// Compare the vertices of a mesh stored as padded Vec3 against PackedVec3, streamed in order and gathered by triangles in random order.
+	// The gather stands for the indexed kernel and the pseudo-normals, whose reads are scattered over the array.
+	// A synthetic wavy grid larger than the last-level cache follows the models.
+	void vertex_storage(const std::vector<Model>& models) {
+		const Model large_model = wavy_grid_model(LARGE_MODEL_RESOLUTION);
+		std::vector<const Model*> suite_models;
+		for (const Model& model : models) suite_models.push_back(&model);
+		suite_models.push_back(&large_model);
+		std::cout << "| Model Name | Vertices | Storage | Memory | Stream | Gather | Checksum |\n";
+		std::cout << "| :--------- | :------- | :------ | :----- | :----- | :----- | :------- |\n";
+		for (const Model* suite_model : suite_models) {
+			const Model& model = *suite_model;
+			const std::vector<Point>& padded = model.mesh.vertices;
+			const std::vector<PackedVec3> packed(padded.begin(), padded.end());
+			std::vector<uint32_t> order(model.triangle_count());
+			for (size_t i = 0; i < order.size(); ++i) order[i] = static_cast<uint32_t>(i);
+			std::shuffle(order.begin(), order.end(), std::mt19937(12345u));
+
+			const double passes = static_cast<double>(VERTEX_STORAGE_PASSES);
+			double checksum = 0.0;
+			const double padded_stream = run_vertex_stream(padded, checksum) * 1e6 / (passes * padded.size());
+			const double padded_gather = run_vertex_gather(padded, model.mesh.indices, order, checksum) * 1e6 / (passes * order.size());
+			std::cout << "| " << model.name << " | " << padded.size() << " | Vec3 | " << padded.size() * sizeof(Point) / (1024.0 * 1024.0) << "MB";
+			std::cout << " | " << padded_stream << "ns | " << padded_gather << "ns | " << checksum << " |\n";
+			checksum = 0.0;
+			const double packed_stream = run_vertex_stream(packed, checksum) * 1e6 / (passes * packed.size());
+			const double packed_gather = run_vertex_gather(packed, model.mesh.indices, order, checksum) * 1e6 / (passes * order.size());
+			std::cout << "| " << model.name << " | " << packed.size() << " | PackedVec3 | " << packed.size() * sizeof(PackedVec3) / (1024.0 * 1024.0) << "MB";
+			std::cout << " | " << packed_stream << "ns | " << packed_gather << "ns | " << checksum << " |\n";
+		}
+	}
+
+} // namespace benchmark
@@ -1,6 +1,5 @@
 #define TINYOBJLOADER_IMPLEMENTATION
 #define ENABLE_MULTITHREADING
-#define ASYNC_TASK_COUNT 256
 #define QUERY_POINT_COUNT 100000
 #define VISUALIZER_QUERY_POINTS
 #define VISUALIZER_BOUNDING_BOXES
@@ -12,11 +11,10 @@
 
 #include <iostream>
 #include <fstream>
-#include <future>
 #include <random>
 #include <thread>
 #include <tiny_obj_loader.h>
-#include <ClosestPointQuery.h>
+#include <SceneClosestPointQuery.h>
 
 using namespace geoutils;
 
@@ -40,10 +38,10 @@ private:
 	std::chrono::steady_clock::time_point start;
 	std::chrono::steady_clock::time_point last_requested_time;
 public:
-	Timer() : start{ std::chrono::high_resolution_clock::now() }, last_requested_time{ start } {}
-	double elapsed_ms() const { return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count() / 1000.0; }
+	Timer() : start{ std::chrono::steady_clock::now() }, last_requested_time{ start } {}
+	double elapsed_ms() const { return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() / 1000.0; }
 	double delta_ms() {
-		const auto now = std::chrono::high_resolution_clock::now();
+		const auto now = std::chrono::steady_clock::now();
 		const double delta_time = std::chrono::duration_cast<std::chrono::microseconds>(now - last_requested_time).count() / 1000.0;
 		last_requested_time = now;
 		return delta_time;
@@ -58,7 +56,7 @@ int main(void) {
 		try {
 			meshes = load_obj_model(MODEL_PATH);
 		}
-		catch (std::exception e) {
+		catch (const std::exception& e) {
 			std::cerr << e.what();
 			return -1;
 		}
@@ -66,42 +64,28 @@ int main(void) {
 	}
 
 	// Generate random query points around the model
-	std::vector<std::pair<float, Point>> query_points(QUERY_POINT_COUNT);
-	for (size_t i = 0; i < QUERY_POINT_COUNT; ++i) query_points[i] = { 0.5f, random_in_unit_sphere() * 1.5f };
+	std::vector<Point> query_points(QUERY_POINT_COUNT);
+	std::vector<float> max_dists(QUERY_POINT_COUNT, 0.5f);
+	for (size_t i = 0; i < QUERY_POINT_COUNT; ++i) query_points[i] = random_in_unit_sphere() * 1.5f;
 
 	// Start the query!
-	std::vector<std::pair<bool, Point>> closest_points(query_points.size());
+	std::vector<uint8_t> found(query_points.size());
+	std::vector<SceneQueryResult> results(query_points.size());
 	{
 		Timer elapsed_timer;
-		for (const Mesh& mesh : meshes) {
-			ClosestPointQuery query(mesh);
-			PRINT_TIME("Construct ClosestPointQuery", elapsed_timer.delta_ms());
-			size_t async_task_count = ASYNC_TASK_COUNT;
-			for (size_t i = 0; i < query_points.size(); i += ASYNC_TASK_COUNT) {
-#ifdef ENABLE_MULTITHREADING
-				async_task_count = std::min((size_t)ASYNC_TASK_COUNT, query_points.size() - i);
-				std::vector<std::future<bool>> threads(async_task_count);
-				for (size_t j = 0; j < async_task_count; ++j) {
-					threads[j] = std::async(std::launch::async,
-						&ClosestPointQuery::operator(), &query,
-						query_points[i + j].second,				// Query point position
-						query_points[i + j].first, 				// Maximum query distance
-						std::ref(closest_points[i + j].second)  // Output closest point
-					);
-				}
-				for (size_t j = 0; j < async_task_count; ++j) {
-					closest_points[i + j].first = threads[j].get();
-				}
-#else
-				closest_points[i].first = query(
-					query_points[i].second,		// Query point position
-					query_points[i].first, 		// Maximum query distance
-					closest_points[i].second	// Output closest point
-				);
+		// A single query over every shape of the model, each query point gets the closest point on any of them.
+		SceneClosestPointQuery query(meshes);
+		PRINT_TIME("Construct SceneClosestPointQuery", elapsed_timer.delta_ms());
+		QueryOptions options;
+		options.order = QueryOrder::Morton; // The query points are random, sorting them lets consecutive queries share the cache.
+#ifndef ENABLE_MULTITHREADING
+		ThreadPool serial_pool(1);
+		options.thread_pool = &serial_pool;
 #endif
-			}
-			PRINT_TIME("Querying " + std::to_string(query_points.size()) + " points on " + std::to_string(mesh.indices.size() / 3) + " triangles", elapsed_timer.delta_ms());
-		}
+		query.query_batch(query_points, max_dists, found, results, options);
+		size_t triangle_count = 0;
+		for (const Mesh& mesh : meshes) triangle_count += mesh.indices.size() / 3;
+		PRINT_TIME("Querying " + std::to_string(query_points.size()) + " points on " + std::to_string(triangle_count) + " triangles in " + std::to_string(meshes.size()) + " meshes", elapsed_timer.delta_ms());
 	}
 
 #ifdef VISUALIZER_QUERY_POINTS
@@ -111,8 +95,8 @@ int main(void) {
 	if (query_points_csv.is_open()) {
 		query_points_csv << MODEL_PATH << "\n";
 		for (size_t i = 0; i < query_points.size(); ++i) {
-			query_points_csv << query_points[i].first << "," << query_points[i].second.x() << "," << query_points[i].second.y() << "," << query_points[i].second.z() << ",";
-			query_points_csv << closest_points[i].first << "," << closest_points[i].second.x() << "," << closest_points[i].second.y() << "," << closest_points[i].second.z() << "\n";
+			query_points_csv << max_dists[i] << "," << query_points[i].x() << "," << query_points[i].y() << "," << query_points[i].z() << ",";
+			query_points_csv << static_cast<int>(found[i]) << "," << results[i].closest_point.x() << "," << results[i].closest_point.y() << "," << results[i].closest_point.z() << "\n";
 		}
 		query_points_csv.close();
 	}
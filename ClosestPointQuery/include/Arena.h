@@ -0,0 +1,38 @@
+#pragma once
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace geoutils {
+
+	// A bump allocator handing out memory from large blocks, everything is freed at once when the arena is destroyed.
+	// Objects are never destroyed individually, the owner is responsible for calling any non-trivial destructors beforehand.
+	// Allocation is thread-safe.
+	class Arena {
+	private:
+		std::vector<void*> blocks;
+		char* cursor = nullptr;
+		size_t remaining = 0;
+		size_t reserved = 0;
+		const size_t block_size;
+		std::mutex mutex;
+	public:
+		static const size_t BLOCK_ALIGNMENT = 64; // Blocks start on a cache line.
+		explicit Arena(size_t block_size = 1 << 20) : block_size{ block_size } {}
+		Arena(const Arena&) = delete;
+		Arena& operator=(const Arena&) = delete;
+		~Arena();
+		// Allocate uninitialized memory, alignment must be a power of two no larger than BLOCK_ALIGNMENT.
+		void* allocate(size_t size, size_t alignment);
+		// Construct an object in the arena.
+		template<typename T, typename... Args>
+		T* create(Args&&... args) { return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...); }
+		// Allocate uninitialized memory for a contiguous array of objects.
+		template<typename T>
+		T* allocate_array(size_t count) { return static_cast<T*>(allocate(sizeof(T) * count, alignof(T))); }
+		// Get the number of bytes reserved from the system, including unused space at the end of each block.
+		size_t memory_usage() const { return reserved; }
+	};
+
+} // namespace geoutils
@@ -1,5 +1,7 @@
 #pragma once
-#include "RStarTree.h"
+#include <memory>
+#include "FrozenRStarTree.h"
+#include "TrianglePacket.h"
 
 namespace geoutils {
 
@@ -11,17 +13,104 @@ namespace geoutils {
 		~Mesh() = default;
 		Mesh(const Mesh&) = default;
 		Mesh& operator=(const Mesh&) = default;
+		Mesh(Mesh&&) = default;
+		Mesh& operator=(Mesh&&) = default;
+	};
+
+	// A non-owning view of a contiguous array, such as a std::vector or a pointer with a size.
+	template<typename T>
+	class Span {
+	private:
+		T* items = nullptr;
+		size_t item_count = 0;
+	public:
+		Span() = default;
+		Span(T* items, size_t count) : items{ items }, item_count{ count } {}
+		template<typename U>
+		Span(std::vector<U>& v) : items{ v.data() }, item_count{ v.size() } {}
+		template<typename U>
+		Span(const std::vector<U>& v) : items{ v.data() }, item_count{ v.size() } {}
+		size_t size() const { return item_count; }
+		T* data() const { return items; }
+		T& operator[](size_t i) const { assert(i < item_count); return items[i]; }
+	};
+
+	// Strategies for constructing the R*-tree of a ClosestPointQuery.
+	enum class TreeConstruction {
+		BulkLoad,		// Pack all triangles at once with Sort-Tile-Recursive. (Default)
+		Incremental,	// Insert leaf buckets one by one with R* reinsertion and splitting.
+	};
+
+	// Layouts of the triangles stored by a ClosestPointQuery, each with its own closest point kernel.
+	enum class TriangleKernel {
+		Vertices,		// Only the vertices, 36 bytes per triangle. See TrianglePacket. (Default)
+		Precomputed,	// Edges, normal and reciprocals computed at construction, 80 bytes per triangle. See PrecomputedTrianglePacket.
+		Jones,			// A transform of each triangle into its own 2D frame, 72 bytes per triangle. See JonesTrianglePacket.
+		Indexed,		// Indices into the vertices of the mesh, 6 bytes per triangle with up to 65536 vertices, else 12. See IndexedTrianglePackets.
+	};
+
+	// Options for constructing a ClosestPointQuery, the defaults favour the fastest construction.
+	struct BuildOptions {
+		TreeConstruction construction = TreeConstruction::BulkLoad;
+		ThreadPool* thread_pool = nullptr; // Pool for parallel bulk-loading, nullptr uses ThreadPool::global(). Pass a single-thread pool to build serially.
+		size_t leaf_size = 8; // Maximum number of spatially close triangles stored contiguously per leaf of the tree, best as a multiple of the packet width.
+		TriangleKernel kernel = TriangleKernel::Vertices;
+		bool pseudo_normals = false; // Precompute the angle-weighted pseudo-normals needed by signed_distance(), 84 bytes per triangle.
+		NodeBounds node_bounds = NodeBounds::Float; // Quantized child boxes shrink the nodes of the tree, at the cost of decoding them and visiting a few more.
+	};
+
+	// Orders in which query_batch visits the query points.
+	enum class QueryOrder {
+		Input,		// The order given by the caller. (Default)
+		Morton,		// Sorted along the Z-order curve, so that consecutive queries of a thread share the nodes and triangles they touch.
+		Hilbert,	// Sorted along the Hilbert curve, more coherent than the Z-order curve but slightly slower to compute.
+	};
+
+	// Ways query_batch walks the tree.
+	enum class QueryTraversal {
+		Single,		// One query point at a time. (Default)
+		Packet,		// A packet of 4 query points (8 with AVX) at a time, testing each node against all of them. Only pays off for coherent query points.
+	};
+
+	// Options for the queries of ClosestPointQuery::query_batch.
+	struct QueryOptions {
+		ThreadPool* thread_pool = nullptr; // Pool running the queries, nullptr uses ThreadPool::global(). Pass a single-thread pool to query serially.
+		QueryOrder order = QueryOrder::Input; // Sorting pays off for large batches of randomly ordered query points. The results are always stored in the input order.
+		QueryTraversal traversal = QueryTraversal::Single; // Packets are formed from consecutive query points in the order above.
+	};
+
+	// Sort the query points along the curve of the order, returning the curve position and index of each point in the sorted order.
+	// Nothing is returned for QueryOrder::Input or batches too small to benefit, the points are then visited in the input order.
+	std::vector<std::pair<uint32_t, uint32_t>> sort_query_points(Span<const Point> query_points, QueryOrder order, ThreadPool& thread_pool);
+
+	// Options for sampling distances on a grid with ClosestPointQuery::bake_grid.
+	struct GridOptions {
+		ThreadPool* thread_pool = nullptr; // Pool baking the tiles of the grid, nullptr uses ThreadPool::global().
+		float max_dist = FLT_MAX; // Samples farther from the mesh are set to max_dist, baking only a narrow band around the surface is much faster. Signed grids need cells smaller than the band.
+		bool signed_distance = false; // Negative behind the surface as in ClosestPointQuery::signed_distance(), requires BuildOptions::pseudo_normals. Samples beyond the band take the sign of the band samples they're connected to.
+	};
+
+	// Everything known about the closest point of a query, see ClosestPointQuery::operator().
+	struct QueryResult {
+		Point closest_point;
+		float distance2 = FLT_MAX;			// Squared distance from the query point to the closest point.
+		uint32_t triangle = UINT32_MAX;		// Index of the closest triangle, whose vertices are Mesh::indices[triangle * 3 + 0..2].
+		Vec3 barycentric;					// Weights of the 3 vertices of the triangle, in the order of Mesh::indices, interpolating the closest point.
+		TriangleFeature feature = TriangleFeature::Face; // Whether the closest point is inside the triangle, on an edge or on a vertex.
 	};
 
 	class ClosestPointQuery {
 	private:
-		// Define a triangle with 3 points
-		struct Triangle {
-			Point vertices[3];
-			explicit Triangle(Point p1, Point p2, Point p3) : vertices{ p1, p2, p3 } {}
-		};
+		using TrianglePacket = geoutils::TrianglePacket<FloatPacket>;
+		using PrecomputedTrianglePacket = geoutils::PrecomputedTrianglePacket<FloatPacket>;
+		using JonesTrianglePacket = geoutils::JonesTrianglePacket<FloatPacket>;
+		using IndexedTrianglePackets16 = geoutils::IndexedTrianglePackets<FloatPacket, uint16_t>;
+		using IndexedTrianglePackets32 = geoutils::IndexedTrianglePackets<FloatPacket, uint32_t>;
 	public:
-		explicit ClosestPointQuery(const Mesh& m);
+		// The query references the mesh, which must outlive it: a QueryResult is derived from its triangles and TriangleKernel::Indexed gathers its vertices.
+		explicit ClosestPointQuery(const Mesh& m, const BuildOptions& options = BuildOptions());
+		// Same as above, taking ownership of the mesh rather than referencing it.
+		explicit ClosestPointQuery(Mesh&& m, const BuildOptions& options = BuildOptions());
 		~ClosestPointQuery() = default;
 		ClosestPointQuery(const ClosestPointQuery&) = default;
 		ClosestPointQuery& operator=(const ClosestPointQuery&) = default;
@@ -29,9 +118,93 @@ namespace geoutils {
 		// Extract the closest point on the mesh within the specified maximum search distance.
 		// Return true if closest point is found, else false.
 		bool operator()(const Point& query_point, float max_dist, Point& closest_point) const;
+		// Same as above, also reporting the squared distance, the triangle, the barycentric coordinates and the feature of the closest point.
+		// Barycentric coordinates are only derived for the closest triangle once the search is done, it costs little more than the query above.
+		// Return true and fill result if closest point is found, else false and result is left untouched.
+		bool operator()(const Point& query_point, float max_dist, QueryResult& result) const;
+		// Query many points at once across the thread pool, storing whether a closest point is found and the closest point of each.
+		// Every query point is searched within the maximum distance at the same index, a single maximum distance applies to all of them.
+		// found and closest_points must hold as many items as query_points. The closest point of a query point without one found is left untouched.
+		// Example:
+		//	std::vector<Point> points = ...;
+		//	std::vector<uint8_t> found(points.size());
+		//	std::vector<Point> closest_points(points.size());
+		//	query.query_batch(points, std::vector<float>{ 0.5f }, found, closest_points);
+		void query_batch(Span<const Point> query_points, Span<const float> max_dists, Span<uint8_t> found, Span<Point> closest_points, const QueryOptions& options = QueryOptions()) const;
+		// Find the signed distance to the mesh within the maximum search distance, positive on the side the counter-clockwise triangles face and negative behind.
+		// The sign is taken from the angle-weighted pseudo-normal of the feature the closest point lies on (J. A. Baerentzen and H. Aanaes, 2005),
+		// which is only reliable for closed, consistently oriented meshes whose triangles share their vertices by index. Requires BuildOptions::pseudo_normals.
+		// Return true and update signed_distance and result if closest point is found, else false.
+		bool signed_distance(const Point& query_point, float max_dist, float& signed_distance, QueryResult& result) const;
+		bool signed_distance(const Point& query_point, float max_dist, float& signed_distance) const {
+			QueryResult result;
+			return this->signed_distance(query_point, max_dist, signed_distance, result);
+		}
+		// Sample the distance to the mesh at the center of every cell of a regular grid over bound, with resolution_x * resolution_y * resolution_z cells.
+		// distances must hold one float per cell, laid out with x varying the fastest: distances[x + resolution_x * (y + resolution_y * z)].
+		// The grid is baked in tiles of neighbouring samples, which gather the buckets within reach of any of their samples from the tree once and share them.
+		// Example:
+		//	std::vector<float> distances(64 * 64 * 64);
+		//	query.bake_grid(query.bound(), 64, 64, 64, distances);
+		void bake_grid(const BoundingBox& bound, size_t resolution_x, size_t resolution_y, size_t resolution_z, Span<float> distances, const GridOptions& options = GridOptions()) const;
+		// Get the unit angle-weighted pseudo-normal of the face, edge or vertex of a result, zero if degenerate. Requires BuildOptions::pseudo_normals.
+		Vec3 pseudo_normal(const QueryResult& result) const;
+		// Retrieve the bounding box of the mesh.
+		BoundingBox bound() const { return r_star_tree.bound(); }
+		// Get the number of bytes held by the triangles, the R-Tree and the mesh if owned.
+		size_t memory_usage() const;
+	private:
+		// Construct the tree and the triangles of the chosen kernel, see the constructors.
+		void build(const Mesh& m, const BuildOptions& options);
+		// Compute the pseudo-normals of every triangle, see signed_distance().
+		void compute_pseudo_normals(const Mesh& m, ThreadPool& thread_pool);
+		// Fill every leaf bucket with whole packets of its triangles, in the given order.
+		template<typename PACKET>
+		void pack_buckets(math::AlignedArray<PACKET>& packets, const Mesh& m, const std::vector<uint32_t>& order, size_t leaf_size, ThreadPool& thread_pool);
+		// Same as above, storing the indices of the vertices of every triangle rather than the vertices.
+		template<typename INDEX>
+		void pack_buckets(IndexedTrianglePackets<FloatPacket, INDEX>& packets, const Mesh& m, const std::vector<uint32_t>& order, size_t leaf_size, ThreadPool& thread_pool);
+		// Call f with the packets of the chosen kernel, the only ones filled, and return its result.
+		template<typename F>
+		decltype(auto) visit_packets(F&& f) const {
+			if (precomputed_packets.size() > 0) return f(precomputed_packets);
+			if (jones_packets.size() > 0) return f(jones_packets);
+			if (indexed_packets16.size() > 0) return f(indexed_packets16);
+			if (indexed_packets32.size() > 0) return f(indexed_packets32);
+			return f(triangle_packets);
+		}
+		// Search the tree for the closest point, running the kernel of the packets on every candidate bucket.
+		// PACKETS is an array of TrianglePacket, PrecomputedTrianglePacket or JonesTrianglePacket, or an IndexedTrianglePackets.
+		template<typename PACKETS>
+		bool closest_point(const PACKETS& packets, const Point& query_point, float max_dist, Point& closest_point) const;
+		// Same as above, keeping track of the packet and lane of the closest triangle to fill the whole result.
+		template<typename PACKETS>
+		bool closest_point(const PACKETS& packets, const Point& query_point, float max_dist, QueryResult& result) const;
+		// Fill result with the triangle in a lane of a packet, once the search found it to be the closest one.
+		// The barycentric coordinates and the feature are derived from the vertices of the mesh, which the packets may only approximate.
+		void fill_result(size_t packet, size_t lane, const Point& query_point, const Point& closest_point, float distance2, QueryResult& result) const;
+		// Bake the grid tile by tile with the kernel of the packets, see bake_grid().
+		template<typename PACKETS>
+		void bake_grid(const PACKETS& packets, const BoundingBox& bound, const size_t (&resolution)[3], Span<float> distances, const GridOptions& options) const;
+		// Search the tree for the closest points of up to FloatPacket::WIDTH query points at once, see QueryTraversal::Packet.
+		template<typename PACKETS>
+		void closest_points(const PACKETS& packets, size_t count, const Point* query_points, const float* max_dists, bool* found, Point* closest_points) const;
+		// Dispatch closest_points() to the packets of the chosen kernel.
+		void closest_points(size_t count, const Point* query_points, const float* max_dists, bool* found, Point* closest_points) const;
 	private:
-		std::vector<Triangle> triangles;
-		RStarTree<Triangle*, 64> r_star_tree;
+		// Only the packets of the chosen kernel are filled. Ordered along a Z-order curve, so that every leaf bucket is a contiguous run of packets.
+		math::AlignedArray<TrianglePacket> triangle_packets;
+		math::AlignedArray<PrecomputedTrianglePacket> precomputed_packets;
+		math::AlignedArray<JonesTrianglePacket> jones_packets;
+		IndexedTrianglePackets16 indexed_packets16;
+		IndexedTrianglePackets32 indexed_packets32;
+		const Mesh* mesh = nullptr; // The mesh the query was built from, either the caller's or the owned one.
+		std::unique_ptr<const Mesh> owned_mesh; // The mesh, if given by rvalue.
+		size_t packets_per_bucket = 1;
+		size_t leaf_size = 1;
+		std::vector<uint32_t> ordered_triangles; // Index of the triangle in Mesh at each position along the buckets, bucket i starts at i * leaf_size.
+		std::vector<PackedVec3> pseudo_normals; // 7 per triangle in the order of Mesh: the face, the edges p1p2, p2p3 and p3p1, then the vertices p1, p2 and p3.
+		FrozenRStarTree<uint32_t, 64> r_star_tree; // Leaf entries are bucket indices, bucket i holds packets [i * packets_per_bucket, (i + 1) * packets_per_bucket).
 	};
 
 } // namespace geoutils
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+#include "ClosestPointQuery.h"
+
+namespace geoutils {
+
+	// Options for building an AdaptiveDistanceField.
+	struct DistanceFieldOptions {
+		ThreadPool* thread_pool = nullptr; // Pool evaluating the cells of each level, nullptr uses ThreadPool::global().
+		float tolerance = 1e-3f; // Maximum error of the interpolated distance accepted in a leaf. Checked against half of it at the lattice points, a margin that has held for the error in between in practice.
+		size_t max_depth = 8; // Cells still beyond the tolerance at this depth fall back to exact queries.
+		float band = FLT_MAX; // Only cells within this distance of the surface are subdivided, the others fall back to exact queries if beyond the tolerance.
+		bool signed_distance = false; // Sample ClosestPointQuery::signed_distance(), requires BuildOptions::pseudo_normals. Unsigned distances have a kink on the surface, which only exact queries resolve.
+	};
+
+	// An adaptively sampled distance field over a box, answering distance queries in O(depth) without searching the mesh.
+	// Following S. F. Frisken et al., Adaptively Sampled Distance Fields, 2000. Every leaf of an octree stores the distances at its 8 corners
+	// and interpolates them trilinearly. A cell is subdivided until the interpolation is within half the tolerance at the center of the cell,
+	// its faces and its edges, where the samples are exact. In between, the error isn't bounded by the samples, but in practice stays within
+	// the tolerance: at most 0.77 times it near the surface of the bunny benchmark. The field keeps a pointer to the query, which must outlive it,
+	// for the cells where the tolerance isn't met and for points outside the box.
+	// Example:
+	//	AdaptiveDistanceField field(query, query.bound());
+	//	float distance = field(Point(0.1f, 0.2f, 0.3f));
+	class AdaptiveDistanceField {
+	private:
+		enum class CellType : uint8_t {
+			Internal,	// Subdivided into 8 children.
+			Leaf,		// Interpolated from its corner distances.
+			Fallback,	// Beyond the tolerance, queried exactly.
+		};
+		struct Cell {
+			uint32_t index = 0; // Index of the first of the 8 children of an internal cell, or of the 8 corner distances of a leaf.
+			CellType type = CellType::Fallback;
+		};
+		const ClosestPointQuery* query = nullptr;
+		BoundingBox root_bound{};
+		bool signed_distance = false;
+		std::vector<Cell> cells; // Children of a cell are consecutive and ordered by octant, x being the lowest bit.
+		std::vector<float> corner_distances; // 8 per leaf, ordered by corner as the octants.
+	public:
+		AdaptiveDistanceField(const ClosestPointQuery& query, const BoundingBox& bound, const DistanceFieldOptions& options = DistanceFieldOptions());
+		// Get the distance to the mesh, interpolated within the tolerance if possible, else exact.
+		float operator()(const Point& point) const {
+			float distance = 0.f;
+			return interpolate(point, distance) ? distance : exact_distance(point);
+		}
+		// Interpolate the distance to the mesh from the leaf containing the point.
+		// Return true and update distance if the point is within the box and its cell within the tolerance, else false.
+		bool interpolate(const Point& point, float& distance) const;
+		// Get the number of cells of the octree, including the internal ones.
+		size_t cell_count() const { return cells.size(); }
+		// Get the number of bytes held by the cells and corner distances.
+		size_t memory_usage() const { return cells.capacity() * sizeof(Cell) + corner_distances.capacity() * sizeof(float); }
+	private:
+		// Query the exact distance to the mesh, signed if the field is.
+		float exact_distance(const Point& point) const;
+	};
+
+} // namespace geoutils
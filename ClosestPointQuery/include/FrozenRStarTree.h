@@ -0,0 +1,392 @@
+#pragma once
+#include <limits>
+#include "RStarTree.h"
+
+namespace geoutils {
+	using FloatPacket = math::FloatPacket;
+
+	// Storage of the child bounding boxes in the nodes of a FrozenRStarTree.
+	// Quantized boxes are stored as offsets within the union of the sibling boxes, rounded outward so that they still bound their children.
+	// They are decoded back to floats with packet instructions during the traversal, the looser boxes only let a few more children through.
+	enum class NodeBounds {
+		Float,			// 32-bit floats, 24 bytes per child. (Default)
+		Quantized16,	// 16-bit offsets, 12 bytes per child.
+		Quantized8,		// 8-bit offsets, 6 bytes per child.
+	};
+
+	// A read-only R*-tree flattened into one contiguous array of nodes, built from a constructed RStarTree.
+	// Nodes are laid out breadth-first, so the children of a node are consecutive and addressed by the 32-bit index of the first one.
+	// The bounds of the children are stored in structure-of-arrays layout within their parent node,
+	// so that a whole packet of child boxes is tested against the query point per instruction, with no square roots involved.
+	// The entries are stored in the order of the leaves, the entries of a leaf-level node are consecutive as well.
+	// The child boxes are stored as floats, or quantized to shrink every node and the memory traffic of a query, see NodeBounds.
+	template<typename DATATYPE, int MAX_NODE = 64>
+	class FrozenRStarTree {
+	public:
+		static const size_t NODE_CAPACITY = (MAX_NODE + FloatPacket::WIDTH - 1) / FloatPacket::WIDTH * FloatPacket::WIDTH; // MAX_NODE rounded up to a whole packet.
+		// The bounds of a packet of children, loaded from a node of any format.
+		struct ChildBoxes {
+			FloatPacket min_x, min_y, min_z, max_x, max_y, max_z;
+		};
+		// A node holding the bounds of its children, padded with empty boxes up to NODE_CAPACITY.
+		struct alignas(64) FrozenNode {
+			float min_x[NODE_CAPACITY], min_y[NODE_CAPACITY], min_z[NODE_CAPACITY];
+			float max_x[NODE_CAPACITY], max_y[NODE_CAPACITY], max_z[NODE_CAPACITY];
+			uint32_t first_child = 0;	// Index of the first child node, or the first entry if has_leaves is set.
+			uint32_t child_count = 0;
+			bool has_leaves = false;	// Indicate whether its children are entries rather than nodes.
+			// Load the bounds of the packet of children starting at index i, a multiple of FloatPacket::WIDTH.
+			ChildBoxes load(size_t i) const {
+				return ChildBoxes{ FloatPacket::load(min_x + i), FloatPacket::load(min_y + i), FloatPacket::load(min_z + i),
+					FloatPacket::load(max_x + i), FloatPacket::load(max_y + i), FloatPacket::load(max_z + i) };
+			}
+			// Broadcast the bounds of the child at index i to every lane.
+			ChildBoxes broadcast(size_t i) const {
+				return ChildBoxes{ FloatPacket(min_x[i]), FloatPacket(min_y[i]), FloatPacket(min_z[i]), FloatPacket(max_x[i]), FloatPacket(max_y[i]), FloatPacket(max_z[i]) };
+			}
+		};
+		// A node holding the bounds of its children as QUANT offsets, see NodeBounds. An offset q on an axis decodes to origin + q * scale.
+		// The padding up to NODE_CAPACITY doesn't decode to empty boxes, the traversal masks the lanes past child_count instead.
+		template<typename QUANT>
+		struct alignas(64) QuantizedNode {
+			QUANT min_x[NODE_CAPACITY], min_y[NODE_CAPACITY], min_z[NODE_CAPACITY];
+			QUANT max_x[NODE_CAPACITY], max_y[NODE_CAPACITY], max_z[NODE_CAPACITY];
+			float origin[3], scale[3];	// The union of the child boxes starts at origin and spans the largest offset times scale.
+			uint32_t first_child = 0;
+			uint32_t child_count = 0;
+			bool has_leaves = false;
+			// Decode the bounds of the packet of children starting at index i, a multiple of FloatPacket::WIDTH.
+			ChildBoxes load(size_t i) const {
+				const FloatPacket origin_x(origin[0]), origin_y(origin[1]), origin_z(origin[2]), scale_x(scale[0]), scale_y(scale[1]), scale_z(scale[2]);
+				return ChildBoxes{ origin_x + FloatPacket::load(min_x + i) * scale_x, origin_y + FloatPacket::load(min_y + i) * scale_y, origin_z + FloatPacket::load(min_z + i) * scale_z,
+					origin_x + FloatPacket::load(max_x + i) * scale_x, origin_y + FloatPacket::load(max_y + i) * scale_y, origin_z + FloatPacket::load(max_z + i) * scale_z };
+			}
+			// Decode the bounds of the child at index i, broadcast to every lane.
+			ChildBoxes broadcast(size_t i) const {
+				return ChildBoxes{ FloatPacket(origin[0] + min_x[i] * scale[0]), FloatPacket(origin[1] + min_y[i] * scale[1]), FloatPacket(origin[2] + min_z[i] * scale[2]),
+					FloatPacket(origin[0] + max_x[i] * scale[0]), FloatPacket(origin[1] + max_y[i] * scale[1]), FloatPacket(origin[2] + max_z[i] * scale[2]) };
+			}
+		};
+	private:
+		// The query point broadcast to every lane.
+		struct QueryPacket {
+			FloatPacket x, y, z;
+			QueryPacket() = default;
+			explicit QueryPacket(const Point& p) : x{ p.x() }, y{ p.y() }, z{ p.z() } {}
+		};
+		// Only the nodes of the chosen format are filled.
+		math::AlignedArray<FrozenNode> float_nodes{};
+		math::AlignedArray<QuantizedNode<uint16_t>> nodes16{};
+		math::AlignedArray<QuantizedNode<uint8_t>> nodes8{};
+		NodeBounds node_bounds = NodeBounds::Float;
+		std::vector<DATATYPE> entries{};
+		BoundingBox root_bound{};
+	public:
+		FrozenRStarTree() = default;
+		FrozenRStarTree(FrozenRStarTree&&) = default;
+		FrozenRStarTree& operator=(FrozenRStarTree&&) = default;
+		// Flatten a constructed tree, the source tree can be discarded afterwards.
+		template<int MIN_NODE>
+		explicit FrozenRStarTree(const RStarTree<DATATYPE, MAX_NODE, MIN_NODE>& tree, NodeBounds node_bounds = NodeBounds::Float) : node_bounds{ node_bounds } {
+			using SourceNode = InternalNode<DATATYPE, MAX_NODE, MIN_NODE>;
+			if (tree.root == nullptr) return;
+			// Gather the nodes breadth-first, children of each node end up consecutive.
+			std::vector<const SourceNode*> order{ tree.root };
+			for (size_t i = 0; i < order.size(); ++i) {
+				if (order[i]->has_leaves) continue;
+				for (size_t j = 0; j < order[i]->children.size(); ++j) {
+					order.push_back(static_cast<const SourceNode*>(order[i]->children[j]));
+				}
+			}
+			assert(order.size() < UINT32_MAX && tree.count() < UINT32_MAX && "Too many nodes for 32-bit indices.");
+
+			entries.reserve(tree.count());
+			root_bound = tree.root->bound;
+			switch (node_bounds) {
+			case NodeBounds::Float: flatten(order, float_nodes); break;
+			case NodeBounds::Quantized16: flatten(order, nodes16); break;
+			case NodeBounds::Quantized8: flatten(order, nodes8); break;
+			}
+		}
+		// Get the number of entries of the tree.
+		size_t count() const { return entries.size(); }
+		// Retrive the bounding box of the tree.
+		const BoundingBox bound() const { return root_bound; }
+		// Get the number of bytes held by the nodes and entries.
+		size_t memory_usage() const {
+			return float_nodes.size() * sizeof(FrozenNode) + nodes16.size() * sizeof(QuantizedNode<uint16_t>) + nodes8.size() * sizeof(QuantizedNode<uint8_t>)
+				+ entries.capacity() * sizeof(DATATYPE);
+		}
+		// Depth-first traversal, invoked on every entries that intersect within the searching radius. See RStarTree::search_radius().
+		template<typename Func>
+		void search_radius(const Point& query_point, float max_dist, Func callback) const {
+			if (node_count() == 0) return;
+			const float radius2 = squared_radius(max_dist);
+			switch (node_bounds) {
+			case NodeBounds::Float: search_radius_internal(float_nodes, QueryPacket(query_point), radius2, callback, 0); break;
+			case NodeBounds::Quantized16: search_radius_internal(nodes16, QueryPacket(query_point), radius2, callback, 0); break;
+			case NodeBounds::Quantized8: search_radius_internal(nodes8, QueryPacket(query_point), radius2, callback, 0); break;
+			}
+		}
+		// Depth-first traversal, invoked as callback(entry, entry_bound) on every entry whose box is within max_dist of the query box.
+		// The box of the entry is decoded from quantized nodes, so it may be slightly larger than the one it was built from.
+		// Return false from the callback to stop the search early.
+		template<typename Func>
+		void search_box(const BoundingBox& query_box, float max_dist, Func callback) const {
+			if (node_count() == 0) return;
+			const float radius2 = squared_radius(max_dist);
+			const QueryPacket min(query_box.min), max(query_box.max);
+			switch (node_bounds) {
+			case NodeBounds::Float: search_box_internal(float_nodes, min, max, radius2, callback, 0); break;
+			case NodeBounds::Quantized16: search_box_internal(nodes16, min, max, radius2, callback, 0); break;
+			case NodeBounds::Quantized8: search_box_internal(nodes8, min, max, radius2, callback, 0); break;
+			}
+		}
+		// Nearest-first traversal with a shrinking search radius. See RStarTree::search_nearest().
+		template<typename Func>
+		void search_nearest(const Point& query_point, float max_dist, Func callback) const {
+			if (node_count() == 0) return;
+			float radius2 = squared_radius(max_dist);
+			switch (node_bounds) {
+			case NodeBounds::Float: search_nearest_internal(float_nodes, QueryPacket(query_point), radius2, callback, 0); break;
+			case NodeBounds::Quantized16: search_nearest_internal(nodes16, QueryPacket(query_point), radius2, callback, 0); break;
+			case NodeBounds::Quantized8: search_nearest_internal(nodes8, QueryPacket(query_point), radius2, callback, 0); break;
+			}
+		}
+		// Nearest-first traversal of a packet of query points at once, one point per lane, so that every node fetched is tested against all of them.
+		// radius2 is an aligned array with the squared search radius of each lane, padding lanes can be disabled with a negative radius.
+		// The callback is invoked as callback(entry, lane_mask) with the mask of the lanes whose radius reaches the entry, and may shrink radius2 of those lanes.
+		// Children are visited in the order of their distance to the closest active lane, which pays off when the query points are coherent.
+		// Example:
+		//	alignas(32) float radius2[FloatPacket::WIDTH] = { ... };
+		//	tree.search_nearest_packet(xs, ys, zs, radius2, [&](const DATATYPE& entry, int lane_mask) { /* process every lane of lane_mask, update radius2 */ });
+		template<typename Func>
+		void search_nearest_packet(const FloatPacket& x, const FloatPacket& y, const FloatPacket& z, float* radius2, Func callback) const {
+			if (node_count() == 0) return;
+			switch (node_bounds) {
+			case NodeBounds::Float: search_nearest_packet_internal(float_nodes, x, y, z, radius2, callback, 0); break;
+			case NodeBounds::Quantized16: search_nearest_packet_internal(nodes16, x, y, z, radius2, callback, 0); break;
+			case NodeBounds::Quantized8: search_nearest_packet_internal(nodes8, x, y, z, radius2, callback, 0); break;
+			}
+		}
+	private:
+		// Get the number of nodes of the chosen format.
+		size_t node_count() const { return float_nodes.size() + nodes16.size() + nodes8.size(); }
+		// Copy the nodes gathered breadth-first in the given format, along with the entries of the leaf-level nodes.
+		template<typename SOURCE, typename NODE>
+		void flatten(const std::vector<const SOURCE*>& order, math::AlignedArray<NODE>& nodes) {
+			nodes = math::AlignedArray<NODE>(order.size());
+			BoundingBox bounds[NODE_CAPACITY];
+			uint32_t next_child = 1;
+			for (size_t i = 0; i < order.size(); ++i) {
+				const SOURCE* source = order[i];
+				NODE* node = &nodes[i];
+				node->has_leaves = source->has_leaves;
+				node->child_count = static_cast<uint32_t>(source->children.size());
+				node->first_child = source->has_leaves ? static_cast<uint32_t>(entries.size()) : next_child;
+				for (size_t j = 0; j < source->children.size(); ++j) bounds[j] = source->children[j]->bound;
+				set_bounds(*node, bounds, source->children.size());
+				if (source->has_leaves) {
+					for (size_t j = 0; j < source->children.size(); ++j) {
+						entries.push_back(static_cast<const LeafNode<DATATYPE>*>(source->children[j])->data);
+					}
+				}
+				else {
+					next_child += node->child_count;
+				}
+			}
+		}
+		// Store the bounds of the children, padded with empty boxes.
+		static void set_bounds(FrozenNode& node, const BoundingBox* bounds, size_t count) {
+			for (size_t j = 0; j < NODE_CAPACITY; ++j) {
+				const BoundingBox& b = j < count ? bounds[j] : BoundingBox{};
+				node.min_x[j] = b.min.x(); node.min_y[j] = b.min.y(); node.min_z[j] = b.min.z();
+				node.max_x[j] = b.max.x(); node.max_y[j] = b.max.y(); node.max_z[j] = b.max.z();
+			}
+		}
+		// Quantize the bounds of the children within their union, rounding every offset down for the minimum and up for the maximum.
+		// Rounding is checked against the decoded coordinates with a few ulps of slack, so that every decoded box contains its child
+		// however the traversal rounds the decoding, such as fused into a multiply-add.
+		template<typename QUANT>
+		static void set_bounds(QuantizedNode<QUANT>& node, const BoundingBox* bounds, size_t count) {
+			const float largest = static_cast<float>(std::numeric_limits<QUANT>::max());
+			BoundingBox frame;
+			for (size_t j = 0; j < count; ++j) frame.enlarge(bounds[j]);
+			QUANT* mins[3] = { node.min_x, node.min_y, node.min_z };
+			QUANT* maxs[3] = { node.max_x, node.max_y, node.max_z };
+			for (size_t axis = 0; axis < 3; ++axis) {
+				const float origin = count > 0 ? frame.min[axis] : 0.f, top = count > 0 ? frame.max[axis] : 0.f;
+				const float slack = (fabsf(origin) + fabsf(top)) * 4.f * FLT_EPSILON;
+				// The largest offset must reach the top of the frame, grow the scale by what the decoded coordinate falls short of.
+				// An offset of 0 decodes to the origin exactly, as does any offset on a flat axis.
+				const float target = top > origin ? top + slack : top;
+				float scale = (top - origin) / largest;
+				for (float reach = decode(origin, scale, largest); reach < target; reach = decode(origin, scale, largest)) scale = nextafterf(scale + (target - reach) / largest, FLT_MAX);
+				node.origin[axis] = origin;
+				node.scale[axis] = scale;
+				for (size_t j = 0; j < NODE_CAPACITY; ++j) {
+					if (j >= count) {
+						mins[axis][j] = std::numeric_limits<QUANT>::max();
+						maxs[axis][j] = 0;
+						continue;
+					}
+					const float min = bounds[j].min[axis], max = bounds[j].max[axis];
+					float low = scale > 0.f ? floorf((min - origin) / scale) : 0.f, high = scale > 0.f ? ceilf((max - origin) / scale) : 0.f;
+					low = std::min(std::max(low, 0.f), largest);
+					high = std::min(std::max(high, 0.f), largest);
+					while (low > 0.f && decode(origin, scale, low) > min - slack) low -= 1.f;
+					while (high < largest && decode(origin, scale, high) < max + slack) high += 1.f;
+					mins[axis][j] = static_cast<QUANT>(low);
+					maxs[axis][j] = static_cast<QUANT>(high);
+				}
+			}
+		}
+		static float decode(float origin, float scale, float offset) { return origin + offset * scale; }
+		// Get the mask of the lanes holding a child in the packet of children starting at index i.
+		template<typename NODE>
+		static int child_mask(const NODE& node, size_t i) {
+			const size_t count = node.child_count - i;
+			return count >= FloatPacket::WIDTH ? (1 << FloatPacket::WIDTH) - 1 : (1 << count) - 1;
+		}
+		// A recursive function for visiting the children closest to any lane of the packet first, see search_nearest_packet().
+		// Every child is tested on its own against the whole packet, the box of a quantized child is decoded as it's tested.
+		template<typename NODE, typename Func>
+		void search_nearest_packet_internal(const math::AlignedArray<NODE>& nodes, const FloatPacket& x, const FloatPacket& y, const FloatPacket& z, float* radius2, Func& callback, uint32_t node_index) const {
+			const NODE& node = nodes[node_index];
+			std::pair<float, uint32_t> candidates[NODE_CAPACITY];
+			size_t candidate_count = 0;
+			const FloatPacket radius2_packet = FloatPacket::load(radius2);
+			for (size_t i = 0; i < node.child_count; ++i) {
+				alignas(32) float distances[FloatPacket::WIDTH];
+				const FloatPacket d2 = distance2(node, i, x, y, z);
+				int mask = (d2 <= radius2_packet).mask();
+				if (mask == 0) continue;
+				d2.store(distances);
+				float closest = FLT_MAX;
+				while (mask != 0) {
+					closest = std::min(closest, distances[math::count_trailing_zeros(mask)]);
+					mask &= mask - 1;
+				}
+				candidates[candidate_count++] = { closest, static_cast<uint32_t>(i) };
+			}
+			std::sort(candidates, candidates + candidate_count, SortByDistance());
+			for (size_t i = 0; i < candidate_count; ++i) {
+				// The radii may have shrunk since the candidates were gathered, recompute the lanes still reaching the child.
+				const int mask = (distance2(node, candidates[i].second, x, y, z) <= FloatPacket::load(radius2)).mask();
+				if (mask == 0) continue;
+				if (node.has_leaves) {
+					callback(entries[node.first_child + candidates[i].second], mask);
+				}
+				else {
+					search_nearest_packet_internal(nodes, x, y, z, radius2, callback, node.first_child + candidates[i].second);
+				}
+			}
+		}
+		// Compute the squared distances from the lanes of the query points to the child box at index i.
+		template<typename NODE>
+		static FloatPacket distance2(const NODE& node, size_t i, const FloatPacket& x, const FloatPacket& y, const FloatPacket& z) {
+			const ChildBoxes b = node.broadcast(i);
+			const FloatPacket zero(0.f);
+			const FloatPacket dx = (b.min_x - x).max(x - b.max_x).max(zero);
+			const FloatPacket dy = (b.min_y - y).max(y - b.max_y).max(zero);
+			const FloatPacket dz = (b.min_z - z).max(z - b.max_z).max(zero);
+			return dx * dx + dy * dy + dz * dz;
+		}
+		// Compute the squared distances from the query point to a packet of child boxes starting at index i, see child_mask() for the padding.
+		template<typename NODE>
+		static FloatPacket distance2(const NODE& node, size_t i, const QueryPacket& q) {
+			const ChildBoxes b = node.load(i);
+			const FloatPacket zero(0.f);
+			const FloatPacket dx = (b.min_x - q.x).max(q.x - b.max_x).max(zero);
+			const FloatPacket dy = (b.min_y - q.y).max(q.y - b.max_y).max(zero);
+			const FloatPacket dz = (b.min_z - q.z).max(q.z - b.max_z).max(zero);
+			return dx * dx + dy * dy + dz * dz;
+		}
+		// A recursive function for searching entries within the radius of a box, return false as soon as the callback asks to stop.
+		template<typename NODE, typename Func>
+		bool search_box_internal(const math::AlignedArray<NODE>& nodes, const QueryPacket& min, const QueryPacket& max, float radius2, Func& callback, uint32_t node_index) const {
+			const NODE& node = nodes[node_index];
+			const FloatPacket zero(0.f), radius2_packet(radius2);
+			for (size_t i = 0; i < node.child_count; i += FloatPacket::WIDTH) {
+				const ChildBoxes b = node.load(i);
+				const FloatPacket dx = (b.min_x - max.x).max(min.x - b.max_x).max(zero);
+				const FloatPacket dy = (b.min_y - max.y).max(min.y - b.max_y).max(zero);
+				const FloatPacket dz = (b.min_z - max.z).max(min.z - b.max_z).max(zero);
+				int mask = (dx * dx + dy * dy + dz * dz <= radius2_packet).mask() & child_mask(node, i);
+				if (mask == 0) continue;
+				alignas(32) float bounds[6][FloatPacket::WIDTH];
+				if (node.has_leaves) {
+					b.min_x.store(bounds[0]); b.min_y.store(bounds[1]); b.min_z.store(bounds[2]);
+					b.max_x.store(bounds[3]); b.max_y.store(bounds[4]); b.max_z.store(bounds[5]);
+				}
+				while (mask != 0) {
+					const size_t lane = math::count_trailing_zeros(mask);
+					mask &= mask - 1;
+					if (node.has_leaves) {
+						const BoundingBox bound{ Point(bounds[0][lane], bounds[1][lane], bounds[2][lane]), Point(bounds[3][lane], bounds[4][lane], bounds[5][lane]) };
+						if (!callback(entries[node.first_child + i + lane], bound)) return false;
+					}
+					else {
+						if (!search_box_internal(nodes, min, max, radius2, callback, node.first_child + static_cast<uint32_t>(i + lane))) return false;
+					}
+				}
+			}
+			return true;
+		}
+		// A recursive function for searching entries within the radius, return false as soon as the callback asks to stop.
+		template<typename NODE, typename Func>
+		bool search_radius_internal(const math::AlignedArray<NODE>& nodes, const QueryPacket& q, float radius2, Func& callback, uint32_t node_index) const {
+			const NODE& node = nodes[node_index];
+			const FloatPacket radius2_packet(radius2);
+			for (size_t i = 0; i < node.child_count; i += FloatPacket::WIDTH) {
+				int mask = (distance2(node, i, q) <= radius2_packet).mask() & child_mask(node, i);
+				while (mask != 0) {
+					const size_t child = i + math::count_trailing_zeros(mask);
+					mask &= mask - 1;
+					if (node.has_leaves) {
+						if (!callback(entries[node.first_child + child])) return false;
+					}
+					else {
+						if (!search_radius_internal(nodes, q, radius2, callback, node.first_child + static_cast<uint32_t>(child))) return false;
+					}
+				}
+			}
+			return true;
+		}
+		// A recursive function for visiting the children closest to the query point first, shrinking radius2 by the value reported from callback.
+		template<typename NODE, typename Func>
+		void search_nearest_internal(const math::AlignedArray<NODE>& nodes, const QueryPacket& q, float& radius2, Func& callback, uint32_t node_index) const {
+			const NODE& node = nodes[node_index];
+			std::pair<float, uint32_t> candidates[NODE_CAPACITY];
+			size_t candidate_count = 0;
+			const FloatPacket radius2_packet(radius2);
+			for (size_t i = 0; i < node.child_count; i += FloatPacket::WIDTH) {
+				alignas(32) float distances[FloatPacket::WIDTH];
+				const FloatPacket d2 = distance2(node, i, q);
+				d2.store(distances);
+				int mask = (d2 <= radius2_packet).mask() & child_mask(node, i);
+				while (mask != 0) {
+					const size_t lane = math::count_trailing_zeros(mask);
+					mask &= mask - 1;
+					candidates[candidate_count++] = { distances[lane], node.first_child + static_cast<uint32_t>(i + lane) };
+				}
+			}
+			std::sort(candidates, candidates + candidate_count, SortByDistance());
+			for (size_t i = 0; i < candidate_count; ++i) {
+				// The radius may have shrunk since the candidates were gathered, the remaining ones are even farther away.
+				if (candidates[i].first > radius2) return;
+				if (node.has_leaves) {
+					radius2 = std::min(radius2, callback(entries[candidates[i].second]));
+				}
+				else {
+					search_nearest_internal(nodes, q, radius2, callback, candidates[i].second);
+				}
+			}
+		}
+		// Ties are broken by index, so that the visiting order doesn't depend on the sort algorithm.
+		struct SortByDistance {
+			bool operator() (const std::pair<float, uint32_t>& a, const std::pair<float, uint32_t>& b) const { return a.first < b.first || (a.first == b.first && a.second < b.second); }
+		};
+	};
+
+} // namespace geoutils
@@ -0,0 +1,212 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "Platform.h"
+
+namespace math {
+
+	// A packet of 4 floats processed in lock step, used for structure-of-arrays data such as the bounding boxes of sibling nodes.
+	// Comparisons return a packet with every bit of the lane set or cleared, which can be combined with & and | or passed to select().
+	// Every backend below shares the same interface, math::Float4 is the one selected for the target in Platform.h.
+
+	// A portable packet of 4 floats without any intrinsics, the lanes are processed one by one.
+	class alignas(16) ScalarFloat4 {
+	private:
+		float _data[4];
+	public:
+		static const size_t WIDTH = 4;
+		ScalarFloat4() : _data{ 0.f, 0.f, 0.f, 0.f } {}
+		ScalarFloat4(float val) : _data{ val, val, val, val } {}
+		// Load from or store to a 16-byte aligned array of 4 floats.
+		static ScalarFloat4 load(const float* ptr) { ScalarFloat4 result; memcpy(result._data, ptr, sizeof(_data)); return result; }
+		void store(float* ptr) const { memcpy(ptr, _data, sizeof(_data)); }
+		// Load 4 unsigned integers converted to floats, such as quantized coordinates. No alignment is required.
+		static ScalarFloat4 load(const uint8_t* ptr) { ScalarFloat4 r; for (int i = 0; i < 4; ++i) r._data[i] = static_cast<float>(ptr[i]); return r; }
+		static ScalarFloat4 load(const uint16_t* ptr) { ScalarFloat4 r; for (int i = 0; i < 4; ++i) r._data[i] = static_cast<float>(ptr[i]); return r; }
+		ScalarFloat4 operator+(const ScalarFloat4& other) const { ScalarFloat4 r; for (int i = 0; i < 4; ++i) r._data[i] = _data[i] + other._data[i]; return r; }
+		ScalarFloat4 operator-(const ScalarFloat4& other) const { ScalarFloat4 r; for (int i = 0; i < 4; ++i) r._data[i] = _data[i] - other._data[i]; return r; }
+		ScalarFloat4 operator*(const ScalarFloat4& other) const { ScalarFloat4 r; for (int i = 0; i < 4; ++i) r._data[i] = _data[i] * other._data[i]; return r; }
+		ScalarFloat4 operator/(const ScalarFloat4& other) const { ScalarFloat4 r; for (int i = 0; i < 4; ++i) r._data[i] = _data[i] / other._data[i]; return r; }
+		ScalarFloat4 operator<(const ScalarFloat4& other) const { ScalarFloat4 r; for (int i = 0; i < 4; ++i) r._data[i] = lane_mask(_data[i] < other._data[i]); return r; }
+		ScalarFloat4 operator<=(const ScalarFloat4& other) const { ScalarFloat4 r; for (int i = 0; i < 4; ++i) r._data[i] = lane_mask(_data[i] <= other._data[i]); return r; }
+		ScalarFloat4 operator>(const ScalarFloat4& other) const { ScalarFloat4 r; for (int i = 0; i < 4; ++i) r._data[i] = lane_mask(_data[i] > other._data[i]); return r; }
+		ScalarFloat4 operator>=(const ScalarFloat4& other) const { ScalarFloat4 r; for (int i = 0; i < 4; ++i) r._data[i] = lane_mask(_data[i] >= other._data[i]); return r; }
+		ScalarFloat4 operator&(const ScalarFloat4& other) const { ScalarFloat4 r; for (int i = 0; i < 4; ++i) r._data[i] = from_bits(to_bits(_data[i]) & to_bits(other._data[i])); return r; }
+		ScalarFloat4 operator|(const ScalarFloat4& other) const { ScalarFloat4 r; for (int i = 0; i < 4; ++i) r._data[i] = from_bits(to_bits(_data[i]) | to_bits(other._data[i])); return r; }
+		// Same NaN behaviour as _mm_min_ps and _mm_max_ps, the second operand is returned when unordered.
+		ScalarFloat4 min(const ScalarFloat4& other) const { ScalarFloat4 r; for (int i = 0; i < 4; ++i) r._data[i] = _data[i] < other._data[i] ? _data[i] : other._data[i]; return r; }
+		ScalarFloat4 max(const ScalarFloat4& other) const { ScalarFloat4 r; for (int i = 0; i < 4; ++i) r._data[i] = _data[i] > other._data[i] ? _data[i] : other._data[i]; return r; }
+		// Get a bit mask of the lanes whose sign bit is set, i.e. the lanes of a comparison that are true.
+		int mask() const { int m = 0; for (int i = 0; i < 4; ++i) m |= static_cast<int>(to_bits(_data[i]) >> 31) << i; return m; }
+		// Pick the lanes from a where the mask is set, otherwise from b.
+		static ScalarFloat4 select(const ScalarFloat4& mask, const ScalarFloat4& a, const ScalarFloat4& b) { ScalarFloat4 r; for (int i = 0; i < 4; ++i) r._data[i] = (to_bits(mask._data[i]) >> 31) ? a._data[i] : b._data[i]; return r; }
+	private:
+		static uint32_t to_bits(float f) { uint32_t u; memcpy(&u, &f, sizeof(u)); return u; }
+		static float from_bits(uint32_t u) { float f; memcpy(&f, &u, sizeof(f)); return f; }
+		static float lane_mask(bool b) { return from_bits(b ? 0xFFFFFFFFu : 0u); }
+	};
+
+#if defined(MATH_HAS_SSE4)
+	// A packet of 4 floats stored in an SSE register.
+	class alignas(16) SseFloat4 {
+	private:
+		__m128 _data;
+	public:
+		static const size_t WIDTH = 4;
+		SseFloat4() : _data{ _mm_setzero_ps() } {}
+		SseFloat4(float val) : _data{ _mm_set_ps1(val) } {}
+		static SseFloat4 load(const float* ptr) { return SseFloat4(_mm_load_ps(ptr)); }
+		void store(float* ptr) const { _mm_store_ps(ptr, _data); }
+		static SseFloat4 load(const uint8_t* ptr) { int32_t bits; memcpy(&bits, ptr, sizeof(bits)); return SseFloat4(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(bits)))); }
+		static SseFloat4 load(const uint16_t* ptr) { return SseFloat4(_mm_cvtepi32_ps(_mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(ptr))))); }
+		SseFloat4 operator+(const SseFloat4& other) const { return SseFloat4(_mm_add_ps(_data, other._data)); }
+		SseFloat4 operator-(const SseFloat4& other) const { return SseFloat4(_mm_sub_ps(_data, other._data)); }
+		SseFloat4 operator*(const SseFloat4& other) const { return SseFloat4(_mm_mul_ps(_data, other._data)); }
+		SseFloat4 operator/(const SseFloat4& other) const { return SseFloat4(_mm_div_ps(_data, other._data)); }
+		SseFloat4 operator<(const SseFloat4& other) const { return SseFloat4(_mm_cmplt_ps(_data, other._data)); }
+		SseFloat4 operator<=(const SseFloat4& other) const { return SseFloat4(_mm_cmple_ps(_data, other._data)); }
+		SseFloat4 operator>(const SseFloat4& other) const { return SseFloat4(_mm_cmpgt_ps(_data, other._data)); }
+		SseFloat4 operator>=(const SseFloat4& other) const { return SseFloat4(_mm_cmpge_ps(_data, other._data)); }
+		SseFloat4 operator&(const SseFloat4& other) const { return SseFloat4(_mm_and_ps(_data, other._data)); }
+		SseFloat4 operator|(const SseFloat4& other) const { return SseFloat4(_mm_or_ps(_data, other._data)); }
+		SseFloat4 min(const SseFloat4& other) const { return SseFloat4(_mm_min_ps(_data, other._data)); }
+		SseFloat4 max(const SseFloat4& other) const { return SseFloat4(_mm_max_ps(_data, other._data)); }
+		int mask() const { return _mm_movemask_ps(_data); }
+		static SseFloat4 select(const SseFloat4& mask, const SseFloat4& a, const SseFloat4& b) { return SseFloat4(_mm_blendv_ps(b._data, a._data, mask._data)); }
+	private:
+		SseFloat4(const __m128& _data) : _data{ _data } {}
+	};
+#endif
+
+#if defined(MATH_HAS_NEON)
+	// A packet of 4 floats stored in a NEON register.
+	class alignas(16) NeonFloat4 {
+	private:
+		float32x4_t _data;
+	public:
+		static const size_t WIDTH = 4;
+		NeonFloat4() : _data{ vdupq_n_f32(0.f) } {}
+		NeonFloat4(float val) : _data{ vdupq_n_f32(val) } {}
+		static NeonFloat4 load(const float* ptr) { return NeonFloat4(vld1q_f32(ptr)); }
+		void store(float* ptr) const { vst1q_f32(ptr, _data); }
+		static NeonFloat4 load(const uint8_t* ptr) {
+			uint32_t bits; memcpy(&bits, ptr, sizeof(bits));
+			return NeonFloat4(vcvtq_f32_u32(vmovl_u16(vget_low_u16(vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(bits)))))));
+		}
+		static NeonFloat4 load(const uint16_t* ptr) { return NeonFloat4(vcvtq_f32_u32(vmovl_u16(vld1_u16(ptr)))); }
+		NeonFloat4 operator+(const NeonFloat4& other) const { return NeonFloat4(vaddq_f32(_data, other._data)); }
+		NeonFloat4 operator-(const NeonFloat4& other) const { return NeonFloat4(vsubq_f32(_data, other._data)); }
+		NeonFloat4 operator*(const NeonFloat4& other) const { return NeonFloat4(vmulq_f32(_data, other._data)); }
+		NeonFloat4 operator/(const NeonFloat4& other) const { return NeonFloat4(vdivq_f32(_data, other._data)); }
+		NeonFloat4 operator<(const NeonFloat4& other) const { return NeonFloat4(vreinterpretq_f32_u32(vcltq_f32(_data, other._data))); }
+		NeonFloat4 operator<=(const NeonFloat4& other) const { return NeonFloat4(vreinterpretq_f32_u32(vcleq_f32(_data, other._data))); }
+		NeonFloat4 operator>(const NeonFloat4& other) const { return NeonFloat4(vreinterpretq_f32_u32(vcgtq_f32(_data, other._data))); }
+		NeonFloat4 operator>=(const NeonFloat4& other) const { return NeonFloat4(vreinterpretq_f32_u32(vcgeq_f32(_data, other._data))); }
+		NeonFloat4 operator&(const NeonFloat4& other) const { return NeonFloat4(vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(_data), vreinterpretq_u32_f32(other._data)))); }
+		NeonFloat4 operator|(const NeonFloat4& other) const { return NeonFloat4(vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(_data), vreinterpretq_u32_f32(other._data)))); }
+		// vminq_f32 and vmaxq_f32 return NaN for unordered lanes, select explicitly to match the other backends.
+		NeonFloat4 min(const NeonFloat4& other) const { return NeonFloat4(vbslq_f32(vcltq_f32(_data, other._data), _data, other._data)); }
+		NeonFloat4 max(const NeonFloat4& other) const { return NeonFloat4(vbslq_f32(vcgtq_f32(_data, other._data), _data, other._data)); }
+		// NEON has no movemask, gather the sign bits lane by lane.
+		int mask() const {
+			const uint32x4_t sign = vshrq_n_u32(vreinterpretq_u32_f32(_data), 31);
+			return static_cast<int>(vgetq_lane_u32(sign, 0) | vgetq_lane_u32(sign, 1) << 1 | vgetq_lane_u32(sign, 2) << 2 | vgetq_lane_u32(sign, 3) << 3);
+		}
+		// Unlike _mm_blendv_ps which only reads the sign bit, the mask must be the result of a comparison.
+		static NeonFloat4 select(const NeonFloat4& mask, const NeonFloat4& a, const NeonFloat4& b) { return NeonFloat4(vbslq_f32(vreinterpretq_u32_f32(mask._data), a._data, b._data)); }
+	private:
+		NeonFloat4(const float32x4_t& _data) : _data{ _data } {}
+	};
+#endif
+
+#if defined(MATH_BACKEND_SSE4)
+	using Float4 = SseFloat4;
+#elif defined(MATH_BACKEND_NEON)
+	using Float4 = NeonFloat4;
+#else
+	using Float4 = ScalarFloat4;
+#endif
+
+#if defined(MATH_BACKEND_AVX)
+	// A packet of 8 floats processed in lock step, see Float4. Only available when compiling with AVX enabled.
+	class alignas(32) Float8 {
+	private:
+		__m256 _data;
+	public:
+		static const size_t WIDTH = 8;
+		Float8() : _data{ _mm256_setzero_ps() } {}
+		Float8(float val) : _data{ _mm256_set1_ps(val) } {}
+		Float8(const Float8& other) : _data{ other._data } {}
+		~Float8() = default;
+		Float8& operator=(const Float8& other) { _data = other._data; return *this; }
+		// Load from or store to a 32-byte aligned array of 8 floats.
+		static Float8 load(const float* ptr) { return Float8(_mm256_load_ps(ptr)); }
+		void store(float* ptr) const { _mm256_store_ps(ptr, _data); }
+		// Load 8 unsigned integers converted to floats, see ScalarFloat4::load(). Widened 4 at a time, which only takes AVX rather than AVX2.
+		static Float8 load(const uint8_t* ptr) {
+			const __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ptr));
+			return from_halves(_mm_cvtepu8_epi32(bytes), _mm_cvtepu8_epi32(_mm_srli_si128(bytes, 4)));
+		}
+		static Float8 load(const uint16_t* ptr) {
+			const __m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+			return from_halves(_mm_cvtepu16_epi32(words), _mm_cvtepu16_epi32(_mm_srli_si128(words, 8)));
+		}
+		Float8 operator+(const Float8& other) const { return Float8(_mm256_add_ps(_data, other._data)); }
+		Float8 operator-(const Float8& other) const { return Float8(_mm256_sub_ps(_data, other._data)); }
+		Float8 operator*(const Float8& other) const { return Float8(_mm256_mul_ps(_data, other._data)); }
+		Float8 operator/(const Float8& other) const { return Float8(_mm256_div_ps(_data, other._data)); }
+		Float8 operator<(const Float8& other) const { return Float8(_mm256_cmp_ps(_data, other._data, _CMP_LT_OQ)); }
+		Float8 operator<=(const Float8& other) const { return Float8(_mm256_cmp_ps(_data, other._data, _CMP_LE_OQ)); }
+		Float8 operator>(const Float8& other) const { return Float8(_mm256_cmp_ps(_data, other._data, _CMP_GT_OQ)); }
+		Float8 operator>=(const Float8& other) const { return Float8(_mm256_cmp_ps(_data, other._data, _CMP_GE_OQ)); }
+		Float8 operator&(const Float8& other) const { return Float8(_mm256_and_ps(_data, other._data)); }
+		Float8 operator|(const Float8& other) const { return Float8(_mm256_or_ps(_data, other._data)); }
+		Float8 min(const Float8& other) const { return Float8(_mm256_min_ps(_data, other._data)); }
+		Float8 max(const Float8& other) const { return Float8(_mm256_max_ps(_data, other._data)); }
+		int mask() const { return _mm256_movemask_ps(_data); }
+		static Float8 select(const Float8& mask, const Float8& a, const Float8& b) { return Float8(_mm256_blendv_ps(b._data, a._data, mask._data)); }
+	private:
+		Float8(const __m256& _data) : _data{ _data } {}
+		static Float8 from_halves(const __m128i& low, const __m128i& high) { return Float8(_mm256_cvtepi32_ps(_mm256_insertf128_si256(_mm256_castsi128_si256(low), high, 1))); }
+	};
+
+	// The widest packet available on the target.
+	using FloatPacket = Float8;
+#else
+	using FloatPacket = Float4;
+#endif
+
+	// A fixed-size heap array aligned for its element type, for structure-of-arrays data loaded into packets.
+	// std::vector doesn't guarantee alignments beyond that of max_align_t before C++17.
+	template<typename T>
+	class AlignedArray {
+		static_assert(std::is_trivially_destructible<T>::value, "AlignedArray never calls the destructor of its items");
+	private:
+		T* items = nullptr;
+		size_t item_count = 0;
+	public:
+		AlignedArray() = default;
+		explicit AlignedArray(size_t count) : item_count{ count } {
+			if (count == 0) return;
+			items = static_cast<T*>(aligned_malloc(sizeof(T) * count, alignof(T)));
+			if (items == nullptr) throw std::bad_alloc();
+			for (size_t i = 0; i < count; ++i) new (items + i) T();
+		}
+		AlignedArray(AlignedArray&& other) : items{ other.items }, item_count{ other.item_count } { other.items = nullptr; other.item_count = 0; }
+		AlignedArray& operator=(AlignedArray&& other) { std::swap(items, other.items); std::swap(item_count, other.item_count); return *this; }
+		AlignedArray(const AlignedArray&) = delete;
+		AlignedArray& operator=(const AlignedArray&) = delete;
+		~AlignedArray() { aligned_free(items); }
+		size_t size() const { return item_count; }
+		// Get the number of bytes held by the items.
+		size_t memory_usage() const { return item_count * sizeof(T); }
+		T* data() { return items; }
+		const T* data() const { return items; }
+		T& operator[](size_t i) { return items[i]; }
+		const T& operator[](size_t i) const { return items[i]; }
+	};
+
+}; // namespace math
@@ -0,0 +1,67 @@
+#pragma once
+#include <cstddef>
+#include <cstdlib>
+
+// Instruction sets available to the math library, detected from the compiler flags.
+// MSVC doesn't define __SSE4_1__, SSE4.1 is assumed on every x86-64 target as before.
+#if defined(__SSE4_1__) || defined(__AVX__) || defined(_M_X64)
+#define MATH_HAS_SSE4 1
+#include <immintrin.h>
+#endif
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER)) // MSVC's /arch:AVX2 implies FMA but doesn't define __FMA__.
+#define MATH_HAS_FMA 1
+#endif
+#if (defined(__ARM_NEON) && defined(__aarch64__)) || defined(_M_ARM64) // The NEON backend relies on AArch64 only instructions such as vdivq_f32.
+#define MATH_HAS_NEON 1
+#include <arm_neon.h>
+#endif
+
+// The backend of math::Vec3 and math::Float4, picked at compile time. Define MATH_BACKEND_SCALAR to force the portable fallback.
+#if defined(MATH_BACKEND_SCALAR)
+#elif defined(MATH_HAS_SSE4)
+#define MATH_BACKEND_SSE4 1
+#if defined(__AVX__)
+#define MATH_BACKEND_AVX 1 // 8-wide packets, see math::Float8.
+#endif
+#elif defined(MATH_HAS_NEON)
+#define MATH_BACKEND_NEON 1
+#else
+#define MATH_BACKEND_SCALAR 1
+#endif
+
+#if defined(_MSC_VER)
+#include <malloc.h>
+#endif
+
+namespace math {
+
+	// Allocate memory aligned to a power of two, freed with aligned_free(). Return nullptr on failure.
+	inline void* aligned_malloc(size_t size, size_t alignment) {
+#if defined(_MSC_VER)
+		return _aligned_malloc(size, alignment);
+#else
+		void* ptr = nullptr;
+		if (alignment < sizeof(void*)) alignment = sizeof(void*);
+		return posix_memalign(&ptr, alignment, size) == 0 ? ptr : nullptr;
+#endif
+	}
+	inline void aligned_free(void* ptr) {
+#if defined(_MSC_VER)
+		_aligned_free(ptr);
+#else
+		free(ptr);
+#endif
+	}
+
+	// Get the index of the lowest set bit of a non-zero mask, such as the first lane of a packet comparison.
+	inline size_t count_trailing_zeros(int mask) {
+#if defined(__GNUC__) || defined(__clang__)
+		return static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+#else
+		size_t count = 0;
+		while ((mask & 1) == 0) { mask >>= 1; ++count; }
+		return count;
+#endif
+	}
+
+}; // namespace math
@@ -1,12 +1,22 @@
 #pragma once
 #include <vector>
 #include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include "Arena.h"
+#include "Packet.h"
+#include "ThreadPool.h"
 #include "Vec3.h"
 #include "assert.h"
 
 namespace geoutils {
 	using Point = math::Vec3;
 	using Vec3 = math::Vec3;
+	using PackedVec3 = math::PackedVec3;
+	using Float4 = math::Float4;
 
 	// A 3D bounding box definition with standard geometric operations.
 	struct BoundingBox {
@@ -39,6 +49,8 @@ namespace geoutils {
 			const BoundingBox overlapped_region = { min.max(other.min), max.min(other.max) };
 			return overlapped_region.area();
 		}
+		// Squared distance from a point to the closest point of the box, zero if the point is inside.
+		float distance2(const Point& point) const { return point.distance2(point.min(max).max(min)); }
 		float distance2_from_center(const BoundingBox& other) const {
 			const Point center = (min + max) / 2.f;
 			const Point other_center = (other.min + other.max) / 2.f;
@@ -46,16 +58,81 @@ namespace geoutils {
 		}
 	};
 
-	// A base class that defines any nodes with a bounding box.
+	// Square a searching radius, saturating to FLT_MAX rather than overflowing an unbounded one.
+	// A negative radius gives -1, which no squared distance is within, so nothing is found as with search_radius().
+	inline float squared_radius(float max_dist) {
+		if (max_dist < 0.f) return -1.f;
+		return max_dist < sqrtf(FLT_MAX) ? max_dist * max_dist : FLT_MAX;
+	}
+
+	// Quantize a coordinate to 10 bits within [min, max].
+	inline uint32_t quantize_10_bits(float value, float min, float max) {
+		if (!(max > min)) return 0;
+		return static_cast<uint32_t>(std::min(std::max((value - min) / (max - min) * 1024.f, 0.f), 1023.f));
+	}
+	// Interleave the lower 10 bits of x, y and z into a 30-bit code, x taking the most significant bit of each triple.
+	inline uint32_t interleave_10_bits(uint32_t x, uint32_t y, uint32_t z) {
+		// Spread the lower 10 bits apart, leaving two zero bits in between each of them.
+		const auto expand_bits = [](uint32_t v) -> uint32_t {
+			v = (v * 0x00010001u) & 0xFF0000FFu;
+			v = (v * 0x00000101u) & 0x0F00F00Fu;
+			v = (v * 0x00000011u) & 0xC30C30C3u;
+			v = (v * 0x00000005u) & 0x49249249u;
+			return v;
+		};
+		return (expand_bits(x) << 2) | (expand_bits(y) << 1) | expand_bits(z);
+	}
+	// Interleave the bits of a point quantized to 10 bits per axis within the bound, giving a 30-bit position along the Z-order curve.
+	inline uint32_t morton_code(const Point& point, const BoundingBox& bound) {
+		return interleave_10_bits(
+			quantize_10_bits(point.x(), bound.min.x(), bound.max.x()),
+			quantize_10_bits(point.y(), bound.min.y(), bound.max.y()),
+			quantize_10_bits(point.z(), bound.min.z(), bound.max.z())
+		);
+	}
+	// Give the 30-bit position of a point along the Hilbert curve within the bound, quantized to 10 bits per axis.
+	// Unlike the Z-order curve, consecutive cells of the Hilbert curve are always adjacent, at the cost of a few more operations.
+	// Converted by the transpose method of J. Skilling, Programming the Hilbert curve (2004).
+	inline uint32_t hilbert_code(const Point& point, const BoundingBox& bound) {
+		uint32_t axes[3] = {
+			quantize_10_bits(point.x(), bound.min.x(), bound.max.x()),
+			quantize_10_bits(point.y(), bound.min.y(), bound.max.y()),
+			quantize_10_bits(point.z(), bound.min.z(), bound.max.z())
+		};
+		// Undo the excess work of the rotations and reflections, from the highest bit down.
+		for (uint32_t q = 1u << 9; q > 1; q >>= 1) {
+			const uint32_t p = q - 1;
+			for (int i = 0; i < 3; ++i) {
+				if (axes[i] & q) {
+					axes[0] ^= p;
+				}
+				else {
+					const uint32_t t = (axes[0] ^ axes[i]) & p;
+					axes[0] ^= t;
+					axes[i] ^= t;
+				}
+			}
+		}
+		// Gray encode.
+		axes[1] ^= axes[0];
+		axes[2] ^= axes[1];
+		uint32_t t = 0;
+		for (uint32_t q = 1u << 9; q > 1; q >>= 1) {
+			if (axes[2] & q) t ^= q - 1;
+		}
+		return interleave_10_bits(axes[0] ^ t, axes[1] ^ t, axes[2] ^ t);
+	}
+
+	// A base class that defines any nodes with a bounding box, tagged by its type rather than a virtual table.
 	struct Node {
 	public:
 		BoundingBox bound{};
+		const bool is_leaf; // Indicate whether it's a LeafNode, otherwise it's an InternalNode.
 	public:
 		Node() = delete;
 		Node(const Node&) = delete;
 		Node& operator=(const Node&) = delete;
-		Node(const BoundingBox& bound) : bound{ bound } {}
-		virtual ~Node() = default;
+		Node(const BoundingBox& bound, bool is_leaf) : bound{ bound }, is_leaf{ is_leaf } {}
 	};
 
 	// Defines a leaf node with a user-defined data entry, inherit from Node class.
@@ -67,44 +144,67 @@ namespace geoutils {
 		LeafNode() = delete;
 		LeafNode(const LeafNode&) = delete;
 		LeafNode& operator=(const LeafNode&) = delete;
-		LeafNode(const BoundingBox& bound, DATATYPE data) : Node{ bound }, data{ data } {}
-		virtual ~LeafNode() override {}
-		void* operator new(size_t i) { return _mm_malloc(i, 16); }
-		void operator delete(void* p) { _mm_free(p); }
+		LeafNode(const BoundingBox& bound, DATATYPE data) : Node{ bound, true }, data{ data } {}
+	};
+
+	// A fixed-capacity array with a std::vector-like interface, stored inline without any heap allocation.
+	template<typename T, size_t CAPACITY>
+	struct FixedVector {
+	private:
+		size_t item_count = 0;
+		T items[CAPACITY];
+	public:
+		size_t size() const { return item_count; }
+		bool empty() const { return item_count == 0; }
+		T* data() { return items; }
+		const T* data() const { return items; }
+		T* begin() { return items; }
+		T* end() { return items + item_count; }
+		const T* begin() const { return items; }
+		const T* end() const { return items + item_count; }
+		T& operator[](size_t idx) { assert(idx < item_count); return items[idx]; }
+		const T& operator[](size_t idx) const { assert(idx < item_count); return items[idx]; }
+		void push_back(const T& item) { assert(item_count < CAPACITY && "FixedVector capacity exceeded."); items[item_count++] = item; }
+		void resize(size_t count) { assert(count <= item_count && "FixedVector can only shrink."); item_count = count; }
+		template<typename Iterator>
+		void assign(Iterator first, Iterator last) {
+			assert(static_cast<size_t>(last - first) <= CAPACITY && "FixedVector capacity exceeded.");
+			item_count = static_cast<size_t>(std::copy(first, last, items) - items);
+		}
 	};
 
 	// Defines an internal node that stores multiple nodes, which can only be one of the types either InternalNode or LeafNode, inherit from Node class.
+	// Children are stored inline with room for one overflowing child, which is split or reinserted right away.
 	template<typename DATATYPE, int MAX_NODE, int MIN_NODE>
 	struct InternalNode : public Node {
 	public:
 		bool has_leaves = false; // Indicate whether its children are in type LeafNode.
-		std::vector<Node*> children{};
+		FixedVector<Node*, MAX_NODE + 1> children{};
 	public:
-		InternalNode(const BoundingBox& bound) : Node{ bound } { children.reserve(MIN_NODE); }
+		InternalNode(const BoundingBox& bound) : Node{ bound, false } {}
 		InternalNode(const InternalNode&) = delete;
 		InternalNode& operator=(const InternalNode&) = delete;
-		void* operator new(size_t i) { return _mm_malloc(i, 16); }
-		void operator delete(void* p) { _mm_free(p); }
-		virtual ~InternalNode() override {
-			for (size_t i = 0; i < children.size(); ++i) {
-				if (children[i] != nullptr) {
-					delete children[i];
-					children[i] = nullptr;
-				}
-			}
-		}
 	};
 
+	template<typename DATATYPE, int MAX_NODE>
+	class FrozenRStarTree;
+
 	// A 3D R*-Tree acceleration structure for spatial storage and query. 
 	// An implementation by following the paper https://epub.ub.uni-muenchen.de/4256/1/31.pdf by N Beckmann et al.
 	template<typename DATATYPE, int MAX_NODE = 64, int MIN_NODE = static_cast<int>(0.4 * static_cast<double>(MAX_NODE))>
 	class RStarTree {
-		using LeafNode = LeafNode<DATATYPE>;
-		using InternalNode = InternalNode<DATATYPE, MAX_NODE, MIN_NODE>;
+		using LeafNode = geoutils::LeafNode<DATATYPE>;
+		using InternalNode = geoutils::InternalNode<DATATYPE, MAX_NODE, MIN_NODE>;
 		const size_t CHOOSE_SUBTREE_P = MAX_NODE / 2;
 		const size_t REINSERT_P = static_cast<size_t>(0.3 * static_cast<double>(MAX_NODE));
+		static const size_t PADDED_NODE = (MAX_NODE + 1 + Float4::WIDTH - 1) / Float4::WIDTH * Float4::WIDTH; // Overflowed node size rounded up to a whole packet.
+		static const size_t BULK_LOAD_CHUNK_SIZE = 16384;	// Number of entries processed per parallel task during bulk-loading.
+		static const size_t RANGES_PER_THREAD = 4;			// Number of leaf ranges per thread during parallel bulk-loading, for load balancing.
+		static const int MORTON_BUCKET_BITS = 12;			// Leading Morton code bits used to partition the leaves during parallel bulk-loading.
 		static_assert(MIN_NODE > 0 && MAX_NODE > 0 && MIN_NODE <= MAX_NODE, "Invalid MIN_NODE or MAX_NODE value for RStarTree");
+		template<typename, int> friend class FrozenRStarTree; // Flattens the nodes for querying.
 	private:
+		Arena arena{}; // Every node of the tree is allocated from here, and freed in one shot with the tree.
 		InternalNode* root = nullptr;
 		size_t size = 0;
 	public:
@@ -112,22 +212,24 @@ namespace geoutils {
 		RStarTree(const RStarTree&) = delete;
 		RStarTree& operator=(const RStarTree&) = delete;
 		~RStarTree() {
-			// Free up memory recursively using virtual destructors.
-			if (root != nullptr) {
-				delete root;
-				root = nullptr;
+			// Node memory is owned by the arena, only the user-defined data may need a destructor call.
+			if (!std::is_trivially_destructible<DATATYPE>::value && root != nullptr) {
+				destroy_leaves(root);
 			}
+			root = nullptr;
 		}
 		// Get the number of leaf nodes of the constructed tree.
 		const size_t count() const { return size; }
+		// Get the number of bytes reserved for the nodes of the tree.
+		size_t memory_usage() const { return arena.memory_usage(); }
 		// Retrive the bounding box of the constructed tree.
 		const BoundingBox bound() const { return root->bound; }
 		// Insert an entry to the structure with a specified bounding box.
 		void insert(const Point& min, const Point& max, DATATYPE data) {
 			const BoundingBox bound{ min, max };
-			LeafNode* new_leaf = new LeafNode(bound, data);
+			LeafNode* new_leaf = arena.create<LeafNode>(bound, data);
 			if (root == nullptr) {
-				root = new InternalNode(bound);
+				root = arena.create<InternalNode>(bound);
 				root->has_leaves = true;
 				root->children.push_back(new_leaf);
 			}
@@ -136,6 +238,43 @@ namespace geoutils {
 			}
 			size++;
 		}
+		// Bulk-load an empty tree from a batch of entries in one go, rather than inserting them one by one.
+		// Nodes are packed bottom-up with Sort-Tile-Recursive (STR), following the paper "STR: A Simple and Efficient Algorithm for R-Tree Packing" by S. Leutenegger et al.
+		// Given a thread pool, the leaf level is partitioned into spatially coherent ranges by Morton code and each range is packed concurrently.
+		// The packed tree remains a valid R*-tree, further entries can still be inserted incrementally.
+		void bulk_load(const std::vector<std::pair<BoundingBox, DATATYPE>>& entries, ThreadPool* thread_pool = nullptr) {
+			assert(root == nullptr && "Bulk-loading is only supported on an empty tree.");
+			if (entries.empty()) return;
+			// All leaves are allocated as one contiguous array, then constructed in place.
+			LeafNode* leaves = arena.allocate_array<LeafNode>(entries.size());
+			std::vector<Node*> nodes(entries.size());
+			const size_t chunk_count = (entries.size() + BULK_LOAD_CHUNK_SIZE - 1) / BULK_LOAD_CHUNK_SIZE;
+			const auto create_leaves = [&](size_t chunk) {
+				const size_t end = std::min((chunk + 1) * BULK_LOAD_CHUNK_SIZE, entries.size());
+				for (size_t i = chunk * BULK_LOAD_CHUNK_SIZE; i < end; ++i) {
+					nodes[i] = new (leaves + i) LeafNode(entries[i].first, entries[i].second);
+				}
+			};
+			bool has_leaves = true;
+			if (thread_pool != nullptr && thread_pool->thread_count() > 1 && chunk_count > 1) {
+				thread_pool->parallel_for(chunk_count, create_leaves);
+				pack_leaves_parallel(nodes, *thread_pool);
+				has_leaves = false;
+			}
+			else {
+				for (size_t chunk = 0; chunk < chunk_count; ++chunk) create_leaves(chunk);
+			}
+			// Pack each level into parent nodes until a single root remains.
+			while (has_leaves || nodes.size() > 1) {
+				std::vector<Node*> parents;
+				parents.reserve(nodes.size() / MAX_NODE + 1);
+				sort_tile_recursive(nodes.data(), nodes.data() + nodes.size(), 0, has_leaves, parents);
+				nodes.swap(parents);
+				has_leaves = false;
+			}
+			root = static_cast<InternalNode*>(nodes[0]);
+			size = entries.size();
+		}
 		// Breadth-first traversal, useful for printing out tree visualization.
 		// Template Argument:
 		//	callback: Callback function that accept (int, Node*) parameters. See example for usage.
@@ -153,7 +292,23 @@ namespace geoutils {
 		//	const auto callback = [&](Triangle* tri) { /* process triangle info. */ };
 		//	tree.search_radius(Point{0.f, 0.f, 0.f}, 1.f, callback);
 		template<typename Func>
-		void search_radius(const Point& query_point, float max_dist, Func callback) const { search_radius_internal(query_point, max_dist, callback, root); }
+		void search_radius(const Point& query_point, float max_dist, Func callback) const { if (root != nullptr) search_radius_internal(query_point, max_dist, callback, root); }
+		// Nearest-first traversal with a shrinking search radius, invoked on entries in ascending order of their bounding box distance.
+		// After each entry the callback reports the best squared distance found so far, every subtree farther than that is pruned.
+		// Template Argument:
+		//	callback: A callable functor that accept (DATATYPE) parameter and return the current best squared distance as float. See example for usage.
+		// Example:
+		//	RStarTree<Triangle*, 64> tree;
+		//	/* insert Triangle* entries into tree */
+		//	float best_distance2 = FLT_MAX;
+		//	const auto callback = [&](Triangle* tri) -> float { /* process triangle info, update best_distance2. */ return best_distance2; };
+		//	tree.search_nearest(Point{0.f, 0.f, 0.f}, FLT_MAX, callback);
+		template<typename Func>
+		void search_nearest(const Point& query_point, float max_dist, Func callback) const {
+			if (root == nullptr) return;
+			float radius2 = squared_radius(max_dist);
+			search_nearest_internal(query_point, radius2, callback, root);
+		}
 	private:
 		// A recursive function for inserting a leaf node to the optimal subtrees.
 		InternalNode* insert_internal(LeafNode* leaf, InternalNode* node, bool first_insert) {
@@ -182,7 +337,7 @@ namespace geoutils {
 				// Split the node, create a new root and reparent if it's the root node.
 				InternalNode* split_node = split(node);
 				if (node == root) {
-					InternalNode* new_root = new InternalNode(BoundingBox{});
+					InternalNode* new_root = arena.create<InternalNode>(BoundingBox{});
 					new_root->children.push_back(root);
 					new_root->children.push_back(split_node);
 					std::for_each(new_root->children.begin(), new_root->children.end(), EnlargeBoundingBox(new_root->bound));
@@ -194,6 +349,84 @@ namespace geoutils {
 			}
 			return nullptr;
 		}
+		// Replace the leaves with their packed parents. The leaves are bucketed by the leading bits of their Morton codes with a counting sort,
+		// consecutive buckets are grouped into ranges of similar size, then each range is packed with STR on the thread pool.
+		void pack_leaves_parallel(std::vector<Node*>& leaves, ThreadPool& thread_pool) {
+			BoundingBox bound{};
+			std::for_each(leaves.begin(), leaves.end(), EnlargeBoundingBox(bound));
+			std::vector<uint32_t> buckets(leaves.size());
+			const size_t chunk_count = (leaves.size() + BULK_LOAD_CHUNK_SIZE - 1) / BULK_LOAD_CHUNK_SIZE;
+			thread_pool.parallel_for(chunk_count, [&](size_t chunk) {
+				const size_t end = std::min((chunk + 1) * BULK_LOAD_CHUNK_SIZE, leaves.size());
+				for (size_t i = chunk * BULK_LOAD_CHUNK_SIZE; i < end; ++i) {
+					buckets[i] = morton_code((leaves[i]->bound.min + leaves[i]->bound.max) * 0.5f, bound) >> (30 - MORTON_BUCKET_BITS);
+				}
+			});
+			std::vector<size_t> bucket_offsets((1 << MORTON_BUCKET_BITS) + 1, 0);
+			for (size_t i = 0; i < buckets.size(); ++i) bucket_offsets[buckets[i] + 1]++;
+			for (size_t i = 1; i < bucket_offsets.size(); ++i) bucket_offsets[i] += bucket_offsets[i - 1];
+			std::vector<Node*> sorted(leaves.size());
+			{
+				std::vector<size_t> cursors(bucket_offsets.begin(), bucket_offsets.end() - 1);
+				for (size_t i = 0; i < leaves.size(); ++i) sorted[cursors[buckets[i]]++] = leaves[i];
+			}
+
+			// Split at bucket boundaries, so that each range covers a compact region of the Z-order curve.
+			const size_t range_count = thread_pool.thread_count() * RANGES_PER_THREAD;
+			std::vector<size_t> range_offsets{ 0 };
+			for (size_t i = 1; i < bucket_offsets.size() && range_offsets.size() < range_count; ++i) {
+				if (bucket_offsets[i] > range_offsets.back() && bucket_offsets[i] >= sorted.size() * range_offsets.size() / range_count) range_offsets.push_back(bucket_offsets[i]);
+			}
+			if (range_offsets.back() != sorted.size()) range_offsets.push_back(sorted.size());
+			// A range of only a few leaves would be packed into parents of fewer than MIN_NODE children, merge it into its neighbour.
+			// Each range is merged forward into the next one, the last range backward into the previous one.
+			size_t range_end = 1;
+			for (size_t i = 1; i < range_offsets.size(); ++i) {
+				if (range_offsets[i] - range_offsets[range_end - 1] >= static_cast<size_t>(MIN_NODE * MAX_NODE)) range_offsets[range_end++] = range_offsets[i];
+			}
+			if (range_end == 1) ++range_end;
+			range_offsets[range_end - 1] = sorted.size();
+			range_offsets.resize(range_end);
+			std::vector<std::vector<Node*>> range_parents(range_offsets.size() - 1);
+			thread_pool.parallel_for(range_parents.size(), [&](size_t i) {
+				range_parents[i].reserve((range_offsets[i + 1] - range_offsets[i]) / MAX_NODE + 1);
+				sort_tile_recursive(sorted.data() + range_offsets[i], sorted.data() + range_offsets[i + 1], 0, true, range_parents[i]);
+			});
+
+			// Stitch the packed ranges together, the upper levels are packed on top of them.
+			leaves.clear();
+			for (const std::vector<Node*>& parents : range_parents) leaves.insert(leaves.end(), parents.begin(), parents.end());
+		}
+		// A recursive function for packing the nodes in range [begin, end) into parent nodes of at most MAX_NODE children.
+		// Sort along the axis and slice into equally sized slabs, then tile each slab recursively along the next axis.
+		// Along the last axis, consecutive runs of nodes are packed into parents that are as evenly filled as possible.
+		void sort_tile_recursive(Node** begin, Node** end, uint8_t axis, bool has_leaves, std::vector<Node*>& parents) {
+			const size_t count = end - begin;
+			const size_t page_count = (count + MAX_NODE - 1) / MAX_NODE;
+			if (page_count > 1) std::sort(begin, end, SortByCenter(axis));
+			if (axis == 2 || page_count == 1) {
+				for (size_t i = 0; i < page_count; ++i) {
+					InternalNode* parent = arena.create<InternalNode>(BoundingBox{});
+					parent->has_leaves = has_leaves;
+					parent->children.assign(begin + count * i / page_count, begin + count * (i + 1) / page_count);
+					std::for_each(parent->children.begin(), parent->children.end(), EnlargeBoundingBox(parent->bound));
+					parents.push_back(parent);
+				}
+				return;
+			}
+			// Each slab holds roughly the same number of pages along the remaining axes.
+			const size_t slab_count = static_cast<size_t>(std::ceil(std::pow(static_cast<double>(page_count), 1.0 / (3 - axis))));
+			for (size_t i = 0; i < slab_count; ++i) {
+				sort_tile_recursive(begin + count * i / slab_count, begin + count * (i + 1) / slab_count, axis + 1, has_leaves, parents);
+			}
+		}
+		// A recursive function for calling the destructor of every leaf node, the memory itself is freed by the arena.
+		void destroy_leaves(InternalNode* node) {
+			for (size_t i = 0; i < node->children.size(); ++i) {
+				if (node->has_leaves) static_cast<LeafNode*>(node->children[i])->~LeafNode();
+				else destroy_leaves(static_cast<InternalNode*>(node->children[i]));
+			}
+		}
 		// A recursive function for visiting all nodes in a breadth-first manner.
 		template<typename Func>
 		void traverse_bfs_internal(Func f, InternalNode* node, int layer) const {
@@ -202,28 +435,53 @@ namespace geoutils {
 				f(layer, node->children[i]);
 			}
 			for (size_t i = 0; i < node->children.size(); ++i) {
-				traverse_bfs_internal(f, dynamic_cast<InternalNode*>(node->children[i]), layer + 1);
+				if (node->children[i]->is_leaf) continue;
+				traverse_bfs_internal(f, static_cast<InternalNode*>(node->children[i]), layer + 1);
 			}
 		}
 		// A recursive function for searching leaf nodes that overlap with the proximity defined by query_point and max_dist.
+		// Return false as soon as the callback asks to stop, which terminates the whole traversal.
 		template<typename Func>
-		bool search_radius_internal(const Point& query_point, float max_dist, Func callback, InternalNode* node) const {
+		bool search_radius_internal(const Point& query_point, float max_dist, Func& callback, InternalNode* node) const {
 			assert(node != nullptr);
 			for (size_t i = 0; i < node->children.size(); ++i) {
 				// Sphere-AABB intersection check, terminate early if there's no overlap.
 				const Vec3 a = query_point.min(node->children[i]->bound.max).max(node->children[i]->bound.min);
 				const float distance = (a - query_point).length();
 				if (distance > max_dist) continue;
-				LeafNode* leaf = dynamic_cast<LeafNode*>(node->children[i]);
-				if (leaf) {
-					callback(leaf->data);
+				if (node->has_leaves) {
+					if (!callback(static_cast<LeafNode*>(node->children[i])->data)) return false;
 				}
 				else {
-					search_radius_internal(query_point, max_dist, callback, static_cast<InternalNode*>(node->children[i]));
+					if (!search_radius_internal(query_point, max_dist, callback, static_cast<InternalNode*>(node->children[i]))) return false;
 				}
 			}
 			return true;
 		}
+		// A recursive function for visiting the children closest to query_point first, shrinking radius2 by the value reported from callback.
+		// Children of each node are sorted by their squared box distance on a per-node stack, so the traversal needs no heap allocation.
+		template<typename Func>
+		void search_nearest_internal(const Point& query_point, float& radius2, Func& callback, InternalNode* node) const {
+			assert(node != nullptr);
+			std::pair<float, Node*> candidates[MAX_NODE + 1];
+			size_t candidate_count = 0;
+			for (size_t i = 0; i < node->children.size(); ++i) {
+				const float distance2 = node->children[i]->bound.distance2(query_point);
+				if (distance2 > radius2) continue;
+				candidates[candidate_count++] = { distance2, node->children[i] };
+			}
+			std::sort(candidates, candidates + candidate_count, SortByDistance());
+			for (size_t i = 0; i < candidate_count; ++i) {
+				// The radius may have shrunk since the candidates were gathered, the remaining ones are even farther away.
+				if (candidates[i].first > radius2) return;
+				if (node->has_leaves) {
+					radius2 = std::min(radius2, callback(static_cast<LeafNode*>(candidates[i].second)->data));
+				}
+				else {
+					search_nearest_internal(query_point, radius2, callback, static_cast<InternalNode*>(candidates[i].second));
+				}
+			}
+		}
 		// Choosing the optimal child node that has the minimal impact (overlapping).
 		InternalNode* choose_subtree(InternalNode* node, const BoundingBox& bound) {
 			assert(node != nullptr);
@@ -234,37 +492,46 @@ namespace geoutils {
 				// Determine the minimum overlap cost.
 				if (MAX_NODE > (CHOOSE_SUBTREE_P * 2) / 3 && node->children.size() > CHOOSE_SUBTREE_P) {
 					std::partial_sort(node->children.begin(), node->children.begin() + CHOOSE_SUBTREE_P, node->children.end(), SortByArea(bound));
-					std::vector<Node*> nodes(node->children.begin(), node->children.begin() + CHOOSE_SUBTREE_P);
-					return static_cast<InternalNode*>(min_overlap_enlargement_node(nodes, bound));
+					return static_cast<InternalNode*>(min_overlap_enlargement_node(node->children.data(), CHOOSE_SUBTREE_P, bound));
 				}
-				return static_cast<InternalNode*>(min_overlap_enlargement_node(node->children, bound));
+				return static_cast<InternalNode*>(min_overlap_enlargement_node(node->children.data(), node->children.size(), bound));
 			}
 			// Child nodes are internal nodes. Choose the minimum area subtree.
-			return static_cast<InternalNode*>(min_area_enlargement_node(node->children, bound));
+			return static_cast<InternalNode*>(min_area_enlargement_node(node->children.data(), node->children.size(), bound));
 		}
 		// Splitting the specified node into two halves. Return the newly splitted node, leaving the input node as the other half.
+		// For each axis, the children are sorted once by their lower and once by their upper bound values. A single sweep per sort order
+		// yields the prefix and suffix bounding boxes, so that every distribution is evaluated without rebuilding its boxes.
+		// The sorted order of the chosen distribution is reused for the final partition.
 		InternalNode* split(InternalNode* node) {
+			const size_t entry_count = MAX_NODE + 1;
 			const size_t distribution_count = MAX_NODE - 2 * MIN_NODE + 2;
 			assert(node != nullptr);
-			assert(node->children.size() == MAX_NODE + 1 && "Node size should be overflowed by one.");
+			assert(node->children.size() == entry_count && "Node size should be overflowed by one.");
 			assert(distribution_count > 0 && "Distribution count must be positive.");
-			assert(MIN_NODE + distribution_count - 1 <= node->children.size() && "Invalid distribution count.");
+			assert(MIN_NODE + distribution_count - 1 <= entry_count - MIN_NODE && "Invalid distribution count.");
 
-			// For each axis, sort the entries by lower then by the upper bound value.
-			// Then determine the best splitting axis by the child nodes minimum margin sum value.
+			// The k-th distribution puts the first (MIN_NODE + k) sorted entries into the first group, and the rest into the second group.
+			// sorted[axis * 2] is sorted by the lower bound values, sorted[axis * 2 + 1] by the upper bound values.
+			Node* sorted[6][MAX_NODE + 1];
+			BoundingBox prefix[MAX_NODE + 1]; // prefix[i] encloses the sorted entries [0, i].
+			BoundingBox suffix[MAX_NODE + 1]; // suffix[i] encloses the sorted entries [i, entry_count).
+
+			// Determine the best splitting axis by the minimum margin sum value over the distributions of both sort orders.
 			const uint8_t INVALID_AXIS = 3;
 			uint8_t best_split_axis = INVALID_AXIS;
 			float least_margin = FLT_MAX;
 			for (uint8_t axis = 0; axis < 3; ++axis) {
-				std::sort(node->children.begin(), node->children.end(), SortByBoundMin(axis));
-				std::sort(node->children.begin(), node->children.end(), SortByBoundMax(axis));
+				std::copy(node->children.begin(), node->children.end(), sorted[axis * 2]);
+				std::copy(node->children.begin(), node->children.end(), sorted[axis * 2 + 1]);
+				std::sort(sorted[axis * 2], sorted[axis * 2] + entry_count, SortByBoundMin(axis));
+				std::sort(sorted[axis * 2 + 1], sorted[axis * 2 + 1] + entry_count, SortByBoundMax(axis));
 				float margin = 0.f;
-				for (size_t k = 0; k < distribution_count; ++k) {
-					BoundingBox left{};
-					BoundingBox right{};
-					std::for_each(node->children.begin(), node->children.begin() + (MIN_NODE + k), EnlargeBoundingBox(left));
-					std::for_each(node->children.begin() + (MIN_NODE + k + 1), node->children.end(), EnlargeBoundingBox(right));
-					margin += left.margin() + right.margin();
+				for (uint8_t order = 0; order < 2; ++order) {
+					sweep_bounds(sorted[axis * 2 + order], entry_count, prefix, suffix);
+					for (size_t k = 0; k < distribution_count; ++k) {
+						margin += prefix[MIN_NODE + k - 1].margin() + suffix[MIN_NODE + k].margin();
+					}
 				}
 				if (margin < least_margin) {
 					best_split_axis = axis;
@@ -279,41 +546,45 @@ namespace geoutils {
 			float least_overlap = FLT_MAX;
 			float least_area = FLT_MAX;
 			size_t best_distribution = INVALID_DISTRIBUTION;
-			for (size_t k = 0; k < distribution_count; ++k) {
-				BoundingBox left{};
-				BoundingBox right{};
-				std::for_each(node->children.begin(), node->children.begin() + (MIN_NODE + k), EnlargeBoundingBox(left));
-				std::for_each(node->children.begin() + (MIN_NODE + k + 1), node->children.end(), EnlargeBoundingBox(right));
-				const float overlap = left.overlap(right);
-				const float area = left.area() + right.area();
-				if (area < least_area) {
-					least_area = area;
-				}
-				if (overlap < least_overlap || (overlap == least_overlap && area == least_area)) {
-					least_overlap = overlap;
-					best_distribution = k;
+			Node** best_sorted = nullptr;
+			BoundingBox best_left{}, best_right{};
+			for (uint8_t order = 0; order < 2; ++order) {
+				Node** entries = sorted[best_split_axis * 2 + order];
+				sweep_bounds(entries, entry_count, prefix, suffix);
+				for (size_t k = 0; k < distribution_count; ++k) {
+					const BoundingBox& left = prefix[MIN_NODE + k - 1];
+					const BoundingBox& right = suffix[MIN_NODE + k];
+					const float overlap = left.overlap(right);
+					const float area = left.area() + right.area();
+					if (overlap < least_overlap || (overlap == least_overlap && area < least_area)) {
+						least_overlap = overlap;
+						least_area = area;
+						best_distribution = k;
+						best_sorted = entries;
+						best_left = left;
+						best_right = right;
+					}
 				}
 			}
 			assert(least_overlap != FLT_MAX && least_area != FLT_MAX && best_distribution != INVALID_DISTRIBUTION && "Invalid split distribution.");
 
-			// Recreate the optimal split with the results found above and perform the split.
-			std::sort(node->children.begin(), node->children.end(), SortByBoundMin(best_split_axis));
-			std::sort(node->children.begin(), node->children.end(), SortByBoundMax(best_split_axis));
-			InternalNode* new_node = new InternalNode(BoundingBox{});
+			// Perform the split with the sorted order found above, the bounding boxes are already known from the sweep.
+			const size_t split_index = MIN_NODE + best_distribution;
+			InternalNode* new_node = arena.create<InternalNode>(best_right);
 			new_node->has_leaves = node->has_leaves;
-			new_node->children.assign(node->children.begin() + (MIN_NODE + best_distribution + 1), node->children.end());
-			node->children.erase(node->children.begin() + (MIN_NODE + best_distribution + 1), node->children.end());
-
-			// Update the bounding box for the 'left' node
-			node->bound.reset();
-			std::for_each(node->children.begin(), node->children.end(), EnlargeBoundingBox(node->bound));
-
-			// Update the bounding box for the 'right' node
-			new_node->bound.reset();
-			std::for_each(new_node->children.begin(), new_node->children.end(), EnlargeBoundingBox(new_node->bound));
+			new_node->children.assign(best_sorted + split_index, best_sorted + entry_count);
+			node->children.assign(best_sorted, best_sorted + split_index);
+			node->bound = best_left;
 
 			return new_node; // Return the 'right' node, leaving the input node as the 'left' node.
 		}
+		// Compute the bounding boxes enclosing every prefix and suffix of the entries in a single sweep each.
+		static void sweep_bounds(Node* const* entries, size_t count, BoundingBox* prefix, BoundingBox* suffix) {
+			prefix[0] = entries[0]->bound;
+			for (size_t i = 1; i < count; ++i) prefix[i] = prefix[i - 1].enlarged(entries[i]->bound);
+			suffix[count - 1] = entries[count - 1]->bound;
+			for (size_t i = count - 1; i > 0; --i) suffix[i - 1] = suffix[i].enlarged(entries[i - 1]->bound);
+		}
 		// An opportunistic reinsertion in hope of constructing a better performing tree by reinserting leaf nodes.
 		// Since depending on the order of insertion during construction, prior grouping and splitting results might not be in an optimal distribution. 
 		void reinsert(InternalNode* node) {
@@ -324,24 +595,25 @@ namespace geoutils {
 
 			// Sort the child nodes by the distance from the node center, pruning the furthest children.
 			std::sort(node->children.begin(), node->children.end(), SortByDistanceFromCenter(node->bound));
-			std::vector<Node*> pruned_nodes(node->children.end() - p, node->children.end());
-			node->children.erase(node->children.end() - p, node->children.end());
+			Node* pruned_nodes[MAX_NODE];
+			std::copy(node->children.end() - p, node->children.end(), pruned_nodes);
+			node->children.resize(node->children.size() - p);
 
 			// Update the node bounding box.
 			node->bound.reset();
 			std::for_each(node->children.begin(), node->children.end(), EnlargeBoundingBox(node->bound));
 
 			// Reinsert the marked nodes at the root level.
-			for (size_t i = 0; i < pruned_nodes.size(); ++i) {
-				assert(dynamic_cast<LeafNode*>(pruned_nodes[i]) != nullptr && "Only leaf nodes can be reinserted.");
+			for (size_t i = 0; i < p; ++i) {
+				assert(pruned_nodes[i]->is_leaf && "Only leaf nodes can be reinserted.");
 				insert_internal(static_cast<LeafNode*>(pruned_nodes[i]), root, false);
 			}
 		}
 		// Find the minimum area enlargement node given a collection of nodes and a bound to be inserted into.
-		Node* min_area_enlargement_node(const std::vector<Node*>& nodes, const BoundingBox& bound) const {
+		Node* min_area_enlargement_node(Node* const* nodes, size_t count, const BoundingBox& bound) const {
 			Node* best_node = nullptr;
 			float least_area = FLT_MAX;
-			for (size_t i = 0; i < nodes.size(); ++i) {
+			for (size_t i = 0; i < count; ++i) {
 				const BoundingBox enlarged_bound = nodes[i]->bound.enlarged(bound);
 				const float enlarged_area = enlarged_bound.area() - nodes[i]->bound.area();
 				if (enlarged_area < least_area) {
@@ -353,18 +625,39 @@ namespace geoutils {
 			return best_node;
 		}
 		// Find the minimum overlapping enlargement node given a collection of nodes and a bound to be inserted into.
-		Node* min_overlap_enlargement_node(const std::vector<Node*>& nodes, const BoundingBox& bound) const {
+		// For each node, expand the node to include the input bound. And for each expanded bound, sum up the overlapped volume with other sibling nodes.
+		// Pick the minimum overlapping enlargement node as the return value.
+		// This is still O(n2) in the worst case, but the sibling boxes are tested 4 at a time in structure-of-arrays layout,
+		// and a node is abandoned as soon as its partial sum can't beat the best one, since every summed term is non-negative.
+		// The terms are summed in the same order as the plain nested loop, so the same node is picked down to the last bit.
+		Node* min_overlap_enlargement_node(Node* const* nodes, size_t count, const BoundingBox& bound) const {
+			assert(count > 0 && count <= PADDED_NODE && "Invalid number of nodes.");
+			// Gather the sibling bounds, padding the tail with empty boxes that never overlap.
+			alignas(16) float min_x[PADDED_NODE], min_y[PADDED_NODE], min_z[PADDED_NODE];
+			alignas(16) float max_x[PADDED_NODE], max_y[PADDED_NODE], max_z[PADDED_NODE];
+			const size_t padded_count = (count + Float4::WIDTH - 1) / Float4::WIDTH * Float4::WIDTH;
+			for (size_t j = 0; j < padded_count; ++j) {
+				const BoundingBox& b = j < count ? nodes[j]->bound : BoundingBox{};
+				min_x[j] = b.min.x(); min_y[j] = b.min.y(); min_z[j] = b.min.z();
+				max_x[j] = b.max.x(); max_y[j] = b.max.y(); max_z[j] = b.max.z();
+			}
+
 			Node* best_node = nullptr;
 			float least_overlap = FLT_MAX;
-			// For each node, expand the node to include the input bound. And for each expanded bound, sum up the overlapped volume with other sibling nodes.
-			// Pick the minimum overlapping enlargement node as the return value.
-			// Note: This is an expensive O(n2) operation, optimize this algorithm if possible.
-			for (size_t i = 0; i < nodes.size(); ++i) {
+			for (size_t i = 0; i < count; ++i) {
 				float overlap = 0.f;
-				const BoundingBox enlarged_bound = nodes[i]->bound.enlarged(bound);
-				for (size_t j = 0; j < nodes.size(); ++j) {
-					if (i == j) continue;
-					overlap += enlarged_bound.overlap(nodes[j]->bound) - nodes[i]->bound.overlap(nodes[j]->bound);
+				const BoundingBox& original_bound = nodes[i]->bound;
+				const BoundingBox enlarged_bound = original_bound.enlarged(bound);
+				for (size_t j = 0; j < padded_count && overlap < least_overlap; j += Float4::WIDTH) {
+					const Float4 b_min_x = Float4::load(min_x + j), b_min_y = Float4::load(min_y + j), b_min_z = Float4::load(min_z + j);
+					const Float4 b_max_x = Float4::load(max_x + j), b_max_y = Float4::load(max_y + j), b_max_z = Float4::load(max_z + j);
+					const Float4 enlarged_overlap = overlap_area(enlarged_bound, b_min_x, b_min_y, b_min_z, b_max_x, b_max_y, b_max_z);
+					const Float4 original_overlap = overlap_area(original_bound, b_min_x, b_min_y, b_min_z, b_max_x, b_max_y, b_max_z);
+					alignas(16) float terms[Float4::WIDTH];
+					(enlarged_overlap - original_overlap).store(terms);
+					for (size_t lane = 0; lane < Float4::WIDTH; ++lane) {
+						if (j + lane != i) overlap += terms[lane];
+					}
 				}
 				if (overlap < least_overlap) {
 					least_overlap = overlap;
@@ -374,6 +667,14 @@ namespace geoutils {
 			assert(best_node != nullptr && least_overlap != FLT_MAX && "Invalid bounds or empty collection of nodes.");
 			return best_node;
 		}
+		// Compute the overlapped volume of a bound with 4 boxes at once, the same value as BoundingBox::overlap() for each lane.
+		static Float4 overlap_area(const BoundingBox& bound, const Float4& min_x, const Float4& min_y, const Float4& min_z, const Float4& max_x, const Float4& max_y, const Float4& max_z) {
+			const Float4 zero(0.f);
+			const Float4 edge_x = (Float4(bound.max.x()).min(max_x) - Float4(bound.min.x()).max(min_x)).max(zero);
+			const Float4 edge_y = (Float4(bound.max.y()).min(max_y) - Float4(bound.min.y()).max(min_y)).max(zero);
+			const Float4 edge_z = (Float4(bound.max.z()).min(max_z) - Float4(bound.min.z()).max(min_z)).max(zero);
+			return edge_x * edge_y * edge_z;
+		}
 	private:
 		// Capturing lambda expressions declaration
 		struct SortByBoundMin {
@@ -386,11 +687,19 @@ namespace geoutils {
 			explicit SortByBoundMax(uint8_t axis) : axis{ axis } {}
 			bool operator()(const Node* a, const Node* b) const { return a->bound.max[axis] < b->bound.max[axis]; }
 		};
+		struct SortByCenter {
+			const uint8_t axis;
+			explicit SortByCenter(uint8_t axis) : axis{ axis } {}
+			bool operator()(const Node* a, const Node* b) const { return a->bound.min[axis] + a->bound.max[axis] < b->bound.min[axis] + b->bound.max[axis]; }
+		};
 		struct SortByArea {
 			const float area;
 			explicit SortByArea(const BoundingBox& bound) : area{ bound.area() } {}
 			bool operator() (const Node* a, const Node* b) const { return area - a->bound.area() < area - b->bound.area(); }
 		};
+		struct SortByDistance {
+			bool operator() (const std::pair<float, Node*>& a, const std::pair<float, Node*>& b) const { return a.first < b.first; }
+		};
 		struct SortByDistanceFromCenter {
 			const BoundingBox& bound;
 			explicit SortByDistanceFromCenter(const BoundingBox& bound) : bound{ bound } {}
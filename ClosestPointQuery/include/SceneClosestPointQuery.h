@@ -0,0 +1,102 @@
+#pragma once
+#include <memory>
+#include "ClosestPointQuery.h"
+
+namespace geoutils {
+
+	// A rotation followed by a translation, which preserves distances. The rotation is stored as the images of the x, y and z axes.
+	// The vectors are stored packed, so that a transform takes 48 bytes, and loaded into Vec3 to be applied.
+	struct RigidTransform {
+		PackedVec3 x_axis{ 1.f, 0.f, 0.f }, y_axis{ 0.f, 1.f, 0.f }, z_axis{ 0.f, 0.f, 1.f };
+		PackedVec3 translation{ 0.f, 0.f, 0.f };
+		RigidTransform() = default;
+		// The axes must be orthonormal, as for a rotation matrix whose columns they are.
+		RigidTransform(const Vec3& x_axis, const Vec3& y_axis, const Vec3& z_axis, const Vec3& translation)
+			: x_axis{ x_axis }, y_axis{ y_axis }, z_axis{ z_axis }, translation{ translation } {}
+		// Rotate by angle radians counter-clockwise around the axis, then translate.
+		static RigidTransform from_axis_angle(const Vec3& axis, float angle, const Vec3& translation) {
+			const Vec3 u = axis.normalize();
+			const float c = cosf(angle), s = sinf(angle);
+			const auto rotate = [&](const Vec3& v) { return v * c + u.cross(v) * s + u * (u.dot(v) * (1.f - c)); };
+			return RigidTransform(rotate(Vec3(1.f, 0.f, 0.f)), rotate(Vec3(0.f, 1.f, 0.f)), rotate(Vec3(0.f, 0.f, 1.f)), translation);
+		}
+		// Map a point from the local space of an instance to the scene.
+		Point apply(const Point& p) const { return Vec3(x_axis) * p.x() + Vec3(y_axis) * p.y() + Vec3(z_axis) * p.z() + Vec3(translation); }
+		// Map a point from the scene to the local space of an instance, the transpose of the rotation is its inverse.
+		Point apply_inverse(const Point& p) const {
+			const Vec3 d = p - Vec3(translation);
+			return Point(d.dot(x_axis), d.dot(y_axis), d.dot(z_axis));
+		}
+		// Bound the box once transformed, by the extent of its rotated half-size around its transformed center.
+		BoundingBox apply(const BoundingBox& b) const {
+			const Point center = apply((b.min + b.max) * 0.5f);
+			const Vec3 half = (b.max - b.min) * 0.5f;
+			const auto absolute = [](const Vec3& v) { return v.max(-v); };
+			const Vec3 extent = absolute(x_axis) * half.x() + absolute(y_axis) * half.y() + absolute(z_axis) * half.z();
+			return BoundingBox{ center - extent, center + extent };
+		}
+	};
+	static_assert(sizeof(RigidTransform) == 48, "RigidTransform must not be padded");
+
+	// A placement of a mesh in a scene, any number of instances share the query of the same mesh.
+	struct MeshInstance {
+		uint32_t mesh = 0; // Index of the mesh among the meshes of the scene.
+		RigidTransform transform;
+	};
+	static_assert(sizeof(MeshInstance) == 52, "MeshInstance must not be padded");
+
+	// The closest point of a query over several meshes, see SceneClosestPointQuery::operator().
+	// The closest point is in the scene, the triangle and barycentric coordinates refer to the mesh in its own space.
+	struct SceneQueryResult : QueryResult {
+		uint32_t mesh = UINT32_MAX; // Index of the mesh of the closest point, the triangle is an index into the indices of that mesh.
+		uint32_t instance = UINT32_MAX; // Index of the instance of the closest point, the same as mesh for a scene without instances.
+	};
+
+	// Closest point queries over several meshes at once, such as the shapes of an OBJ file, optionally placed many times as instances.
+	// Every unique mesh keeps its own ClosestPointQuery, and a small top-level R*-tree over the bounding boxes of the instances visits the ones
+	// closest to the query point first. The search radius shrinks to the best distance found so far, so farther instances are pruned without
+	// touching their trees. An instance is searched by moving the query point into the space of its mesh, so memory grows with unique geometry
+	// and only sizeof(MeshInstance), 52 bytes, per instance plus its entry in the top-level tree.
+	// Example:
+	//	SceneClosestPointQuery scene(meshes);
+	//	SceneQueryResult result;
+	//	if (scene(Point(0.1f, 0.2f, 0.3f), 0.5f, result)) { /* result.mesh, result.closest_point */ }
+	class SceneClosestPointQuery {
+	public:
+		// Construct a query per mesh with the same options, referencing the meshes, which must outlive the scene. Meshes without triangles are never reported.
+		explicit SceneClosestPointQuery(const std::vector<Mesh>& meshes, const BuildOptions& options = BuildOptions());
+		// Same as above, placing the meshes as the given instances rather than once each where they are. Meshes without instances are never reported.
+		SceneClosestPointQuery(const std::vector<Mesh>& meshes, const std::vector<MeshInstance>& instances, const BuildOptions& options = BuildOptions());
+		~SceneClosestPointQuery() = default;
+		SceneClosestPointQuery(const SceneClosestPointQuery&) = delete;
+		SceneClosestPointQuery& operator=(const SceneClosestPointQuery&) = delete;
+
+		// Extract the closest point on any of the meshes within the specified maximum search distance.
+		// Return true and fill result if closest point is found, else false and result is left untouched.
+		bool operator()(const Point& query_point, float max_dist, SceneQueryResult& result) const;
+		// Query many points at once across the thread pool, see ClosestPointQuery::query_batch(). Every query walks the trees one point at a time,
+		// QueryOptions::traversal is ignored. found and results must hold as many items as query_points.
+		void query_batch(Span<const Point> query_points, Span<const float> max_dists, Span<uint8_t> found, Span<SceneQueryResult> results, const QueryOptions& options = QueryOptions()) const;
+		// Get the query of a mesh in its own space, in the order given at construction.
+		const ClosestPointQuery& mesh_query(size_t mesh) const { return *queries[mesh]; }
+		// Get the number of meshes, including the ones without triangles.
+		size_t mesh_count() const { return queries.size(); }
+		// Get an instance, in the order given at construction.
+		const MeshInstance& instance(size_t instance) const { return instances[instance]; }
+		// Get the number of instances, one per mesh unless given at construction.
+		size_t instance_count() const { return instances.size(); }
+		// Retrieve the bounding box of all instances.
+		BoundingBox bound() const { return instance_tree.bound(); }
+		// Get the number of bytes held by the queries of every mesh, the instances and the top-level tree.
+		size_t memory_usage() const {
+			size_t bytes = instances.capacity() * sizeof(MeshInstance) + instance_tree.memory_usage();
+			for (const auto& query : queries) bytes += query->memory_usage();
+			return bytes;
+		}
+	private:
+		std::vector<std::unique_ptr<const ClosestPointQuery>> queries;
+		std::vector<MeshInstance> instances;
+		FrozenRStarTree<uint32_t, 8> instance_tree; // Leaf entries are instance indices.
+	};
+
+} // namespace geoutils
@@ -0,0 +1,174 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace geoutils {
+
+	// A persistent pool of worker threads, so that parallel work doesn't pay for thread creation on every call.
+	// The calling thread always participates in the work, a pool of one thread runs everything serially on the caller.
+	class ThreadPool {
+	private:
+		std::vector<std::thread> workers;
+		std::queue<std::function<void()>> tasks;
+		std::mutex mutex;
+		std::condition_variable condition;
+		bool stopping = false;
+	public:
+		// Create a pool with the given number of threads including the calling thread, zero picks the hardware concurrency.
+		explicit ThreadPool(size_t thread_count = 0);
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+		~ThreadPool();
+		// Get the number of threads that work on a parallel_for, including the calling thread.
+		size_t thread_count() const { return workers.size() + 1; }
+		// Invoke func(i) for every i in [0, count) across the pool and block until all of them are done.
+		// Template Argument:
+		//	func: A callable functor that accept (size_t) parameter. See example for usage.
+		// Example:
+		//	std::vector<float> values(1000);
+		//	ThreadPool::global().parallel_for(values.size(), [&](size_t i) { values[i] = sqrtf(float(i)); });
+		template<typename Func>
+		void parallel_for(size_t count, Func func) {
+			if (count == 0) return;
+			if (workers.empty() || count == 1) {
+				for (size_t i = 0; i < count; ++i) func(i);
+				return;
+			}
+			// Helpers that start after all indices are claimed only touch the shared state, which outlives this call.
+			const std::shared_ptr<ParallelForState> state = std::make_shared<ParallelForState>(count, std::function<void(size_t)>(func));
+			const size_t helper_count = std::min(workers.size(), count - 1);
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				for (size_t i = 0; i < helper_count; ++i) tasks.push([state]() { state->run(); });
+			}
+			if (helper_count == 1) condition.notify_one();
+			else condition.notify_all();
+			state->run();
+			state->wait();
+		}
+		// Invoke func(begin, end) on chunks of at most chunk_size indices covering [0, count), across the pool, and block until all are done.
+		// Every thread starts on its own contiguous share of the range and steals half of the remaining share of another thread once done,
+		// so that uneven chunks balance out with little contention, and work queued behind a busy helper is picked up by the others.
+		// Example:
+		//	std::vector<float> values(100000);
+		//	ThreadPool::global().parallel_for_chunked(values.size(), 256, [&](size_t begin, size_t end) {
+		//		for (size_t i = begin; i < end; ++i) values[i] = sqrtf(float(i));
+		//	});
+		template<typename Func>
+		void parallel_for_chunked(size_t count, size_t chunk_size, Func func) {
+			if (count == 0) return;
+			assert(count < UINT32_MAX && "Too many indices for a parallel_for_chunked.");
+			chunk_size = std::max<size_t>(chunk_size, 1);
+			const size_t chunk_count = (count + chunk_size - 1) / chunk_size;
+			if (workers.empty() || chunk_count == 1) {
+				for (size_t begin = 0; begin < count; begin += chunk_size) func(begin, std::min(begin + chunk_size, count));
+				return;
+			}
+			const size_t helper_count = std::min(workers.size(), chunk_count - 1);
+			const std::shared_ptr<WorkStealingState> state = std::make_shared<WorkStealingState>(count, chunk_size, helper_count + 1, std::function<void(size_t, size_t)>(func));
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				for (size_t i = 0; i < helper_count; ++i) tasks.push([state]() { state->run(); });
+			}
+			if (helper_count == 1) condition.notify_one();
+			else condition.notify_all();
+			state->run();
+			state->wait();
+		}
+		// A lazily created pool shared by the whole process, sized by the hardware concurrency.
+		static ThreadPool& global();
+	private:
+		// Shared progress of a parallel_for, indices are claimed one at a time by the caller and any helper.
+		struct ParallelForState {
+			const size_t count;
+			const std::function<void(size_t)> func;
+			std::atomic<size_t> next{ 0 };
+			std::atomic<size_t> done{ 0 };
+			std::mutex mutex;
+			std::condition_variable condition;
+			ParallelForState(size_t count, std::function<void(size_t)> func) : count{ count }, func{ std::move(func) } {}
+			void run() {
+				for (size_t i = next++; i < count; i = next++) {
+					func(i);
+					if (++done == count) {
+						std::lock_guard<std::mutex> lock(mutex);
+						condition.notify_all();
+					}
+				}
+			}
+			void wait() {
+				std::unique_lock<std::mutex> lock(mutex);
+				condition.wait(lock, [this]() { return done == count; });
+			}
+		};
+		// Shared progress of a parallel_for_chunked. Each participant owns a range [begin, end) packed into one atomic word,
+		// the owner claims chunks from the front and thieves split off the back half, both with a compare-and-swap.
+		struct WorkStealingState {
+			const size_t count;
+			const size_t chunk_size;
+			const size_t participant_count;
+			const std::function<void(size_t, size_t)> func;
+			std::unique_ptr<std::atomic<uint64_t>[]> ranges;
+			std::atomic<size_t> next_participant{ 0 };
+			std::atomic<size_t> done{ 0 };
+			std::mutex mutex;
+			std::condition_variable condition;
+			WorkStealingState(size_t count, size_t chunk_size, size_t participant_count, std::function<void(size_t, size_t)> func)
+				: count{ count }, chunk_size{ chunk_size }, participant_count{ participant_count }, func{ std::move(func) }, ranges{ new std::atomic<uint64_t>[participant_count] } {
+				for (size_t i = 0; i < participant_count; ++i) ranges[i] = pack(count * i / participant_count, count * (i + 1) / participant_count);
+			}
+			static uint64_t pack(size_t begin, size_t end) { return static_cast<uint64_t>(begin) << 32 | static_cast<uint64_t>(end); }
+			static size_t begin_of(uint64_t range) { return static_cast<size_t>(range >> 32); }
+			static size_t end_of(uint64_t range) { return static_cast<size_t>(range & 0xFFFFFFFFu); }
+			void run() {
+				const size_t self = next_participant++;
+				if (self >= participant_count) return; // Every share has been taken by earlier participants, nothing left to own.
+				do {
+					// Drain the own range a chunk at a time.
+					uint64_t range = ranges[self].load();
+					while (begin_of(range) < end_of(range)) {
+						const size_t begin = begin_of(range), end = std::min(begin + chunk_size, end_of(range));
+						if (!ranges[self].compare_exchange_weak(range, pack(end, end_of(range)))) continue;
+						func(begin, end);
+						if ((done += end - begin) == count) {
+							std::lock_guard<std::mutex> lock(mutex);
+							condition.notify_all();
+						}
+						range = ranges[self].load();
+					}
+				} while (steal(self));
+			}
+			// Move the back half of the remaining range of another participant into the own, empty range. Return false if there's nothing left to steal.
+			bool steal(size_t self) {
+				for (size_t i = 1; i < participant_count; ++i) {
+					std::atomic<uint64_t>& victim = ranges[(self + i) % participant_count];
+					uint64_t range = victim.load();
+					while (begin_of(range) < end_of(range)) {
+						const size_t remaining = end_of(range) - begin_of(range);
+						const size_t middle = remaining > chunk_size ? end_of(range) - remaining / 2 : begin_of(range);
+						if (victim.compare_exchange_weak(range, pack(begin_of(range), middle))) {
+							ranges[self] = pack(middle, end_of(range));
+							return true;
+						}
+					}
+				}
+				return false;
+			}
+			void wait() {
+				std::unique_lock<std::mutex> lock(mutex);
+				condition.wait(lock, [this]() { return done == count; });
+			}
+		};
+		void worker_loop();
+	};
+
+} // namespace geoutils
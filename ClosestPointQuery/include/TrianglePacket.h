@@ -0,0 +1,374 @@
+#pragma once
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "Packet.h"
+#include "Vec3.h"
+
+namespace geoutils {
+	using Point = math::Vec3;
+	using Vec3 = math::Vec3;
+	using PackedVec3 = math::PackedVec3;
+
+	// Find the closest point on a single triangle, only if it's closer than shortest_distance (squared).
+	// Project the query point onto the triangle's plane, then use the winding order to determine which edges it lies outside of.
+	// A detailed explanation can be found in README.md.
+	// Return true and update shortest_distance and closest_point if a closer point is found, else false.
+	inline bool closest_point_on_triangle(const Point& query_point, const Point (&vert)[3], float& shortest_distance, Point& closest_point) {
+		uint8_t outside_count = 0;
+		bool found = false;
+		// Determine the triangle normal and projected point.
+		const Vec3 normal = (vert[1] - vert[0]).cross(vert[2] - vert[0]).normalize();
+		const Vec3 projection = normal * (vert[0] - query_point).dot(normal);
+		const float distance_to_plane = projection.length2();
+
+		// Early termination. (distance_to_plane is already the shortest possible distance to the triangle, there's no reason to proceed)
+		// Also skips degenerate triangles, whose normal and distance_to_plane are NaN.
+		if (!(distance_to_plane <= shortest_distance)) return false;
+
+		const Point projected = query_point + projection;
+		for (uint8_t i = 0; i < 3; ++i) {
+			const Point& v1 = vert[i];
+			const Point& v2 = vert[(i + 1) % 3];
+
+			// Utilize the winding order to determine if the point lies outside of an edge.
+			const bool outside = (v1 - projected).cross(v2 - projected).dot(normal) < 0.f;
+			if (outside) {
+				outside_count++;
+				// Clamp the projection value to be in-between of the two ends of the edge.
+				const float t = std::min(std::max((v2 - v1).dot(projected - v1) / v1.distance2(v2), 0.f), 1.f);
+				const Point closest_point_on_edge = v1 * (1.f - t) + v2 * t;
+				const float distance_to_edge = query_point.distance2(closest_point_on_edge);
+				if (distance_to_edge < shortest_distance) {
+					closest_point = closest_point_on_edge;
+					shortest_distance = distance_to_edge;
+					found = true;
+				}
+			}
+
+			// Early termination. (A point can only be outside of at most 2 edges)
+			if (outside_count > 1) return found;
+		}
+
+		// Projection of the query point lies within the triangle.
+		if (outside_count == 0) {
+			closest_point = projected;
+			shortest_distance = distance_to_plane;
+			found = true;
+		}
+		return found;
+	}
+
+	// Features of a triangle on which the closest point to a query point can lie.
+	enum class TriangleFeature : uint8_t {
+		Face,	// Inside the triangle.
+		Edge,	// On an edge, the barycentric coordinate of the opposite vertex is zero.
+		Vertex,	// On a vertex, its barycentric coordinate is one and the others zero.
+	};
+
+	// Find the barycentric coordinates of the closest point on a triangle, as weights of vertices a, b and c, and the feature it lies on.
+	// The regions are tested in the order of Real-Time Collision Detection by C. Ericson, 5.1.5, the same as TrianglePacket::closest_point().
+	inline TriangleFeature closest_feature_on_triangle(const Point& query_point, const Point& a, const Point& b, const Point& c, Vec3& barycentric) {
+		const Vec3 ab = b - a, ac = c - a, ap = query_point - a;
+		const float d1 = ab.dot(ap), d2 = ac.dot(ap);
+		if (d1 <= 0.f && d2 <= 0.f) { barycentric = Vec3(1.f, 0.f, 0.f); return TriangleFeature::Vertex; }
+		const Vec3 bp = query_point - b;
+		const float d3 = ab.dot(bp), d4 = ac.dot(bp);
+		if (d3 >= 0.f && d4 <= d3) { barycentric = Vec3(0.f, 1.f, 0.f); return TriangleFeature::Vertex; }
+		const float vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.f && d1 >= 0.f && d3 <= 0.f) { const float v = d1 / (d1 - d3); barycentric = Vec3(1.f - v, v, 0.f); return TriangleFeature::Edge; }
+		const Vec3 cp = query_point - c;
+		const float d5 = ab.dot(cp), d6 = ac.dot(cp);
+		if (d6 >= 0.f && d5 <= d6) { barycentric = Vec3(0.f, 0.f, 1.f); return TriangleFeature::Vertex; }
+		const float vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.f && d2 >= 0.f && d6 <= 0.f) { const float w = d2 / (d2 - d6); barycentric = Vec3(1.f - w, 0.f, w); return TriangleFeature::Edge; }
+		const float va = d3 * d6 - d5 * d4;
+		if (va <= 0.f && d4 - d3 >= 0.f && d5 - d6 >= 0.f) { const float w = (d4 - d3) / ((d4 - d3) + (d5 - d6)); barycentric = Vec3(0.f, 1.f - w, w); return TriangleFeature::Edge; }
+		const float denom = 1.f / (va + vb + vc);
+		const float v = vb * denom, w = vc * denom;
+		barycentric = Vec3(1.f - v - w, v, w);
+		return TriangleFeature::Face;
+	}
+
+	// Pick the closest lane of a packet kernel out of the ones that are closer than shortest_distance.
+	// Return true and update shortest_distance, closest_point and closest_lane (if not null) if there's any, else false.
+	template<typename FLOAT>
+	inline bool select_closest_lane(const FLOAT& distance2, const FLOAT& cx, const FLOAT& cy, const FLOAT& cz, float& shortest_distance, Point& closest_point, size_t* closest_lane) {
+		int mask = (distance2 < FLOAT(shortest_distance)).mask();
+		if (mask == 0) return false;
+		alignas(sizeof(FLOAT)) float distances[FLOAT::WIDTH], closest_x[FLOAT::WIDTH], closest_y[FLOAT::WIDTH], closest_z[FLOAT::WIDTH];
+		distance2.store(distances);
+		size_t best = 0;
+		float best_distance = shortest_distance;
+		for (size_t lane = 0; mask != 0; ++lane, mask >>= 1) {
+			if ((mask & 1) && distances[lane] < best_distance) {
+				best = lane;
+				best_distance = distances[lane];
+			}
+		}
+		cx.store(closest_x); cy.store(closest_y); cz.store(closest_z);
+		closest_point = Point(closest_x[best], closest_y[best], closest_z[best]);
+		shortest_distance = best_distance;
+		if (closest_lane != nullptr) *closest_lane = best;
+		return true;
+	}
+
+	// A packet of triangles in structure-of-arrays layout, one triangle per lane of FLOAT (math::Float4 or math::Float8).
+	// The closest point kernel runs on all of them in lock step, without branches, square roots or per-triangle normals.
+	// Unused lanes should hold a copy of another triangle of the packet, so that every lane stays valid.
+	template<typename FLOAT>
+	struct alignas(sizeof(FLOAT)) TrianglePacket {
+		static const size_t WIDTH = FLOAT::WIDTH;
+		float x[3][WIDTH], y[3][WIDTH], z[3][WIDTH]; // Coordinates of the 3 vertices of each lane.
+
+		void set(size_t lane, const Point& p1, const Point& p2, const Point& p3) {
+			const Point* vert[3] = { &p1, &p2, &p3 };
+			for (size_t i = 0; i < 3; ++i) {
+				x[i][lane] = vert[i]->x();
+				y[i][lane] = vert[i]->y();
+				z[i][lane] = vert[i]->z();
+			}
+		}
+		// Get the vertices of the triangle in a lane, in the order they were set.
+		void get(size_t lane, Point& p1, Point& p2, Point& p3) const {
+			p1 = Point(x[0][lane], y[0][lane], z[0][lane]);
+			p2 = Point(x[1][lane], y[1][lane], z[1][lane]);
+			p3 = Point(x[2][lane], y[2][lane], z[2][lane]);
+		}
+		// Find the closest point on any of the triangles, only if it's closer than shortest_distance (squared).
+		// Classify the query point into the Voronoi regions of the vertices, edges and face of each triangle,
+		// see Real-Time Collision Detection by C. Ericson, 5.1.5. Every region is evaluated and the matching one is selected per lane.
+		// Return true and update shortest_distance, closest_point and the lane of the closest triangle (if not null) if a closer point is found, else false.
+		bool closest_point(const Point& query_point, float& shortest_distance, Point& closest_point, size_t* closest_lane = nullptr) const {
+			const FLOAT zero(0.f), one(1.f);
+			const FLOAT px(query_point.x()), py(query_point.y()), pz(query_point.z());
+			const FLOAT ax = FLOAT::load(x[0]), ay = FLOAT::load(y[0]), az = FLOAT::load(z[0]);
+			const FLOAT abx = FLOAT::load(x[1]) - ax, aby = FLOAT::load(y[1]) - ay, abz = FLOAT::load(z[1]) - az;
+			const FLOAT acx = FLOAT::load(x[2]) - ax, acy = FLOAT::load(y[2]) - ay, acz = FLOAT::load(z[2]) - az;
+			// Project the query point relative to each vertex onto both edges from vertex a.
+			const FLOAT apx = px - ax, apy = py - ay, apz = pz - az;
+			const FLOAT d1 = abx * apx + aby * apy + abz * apz;
+			const FLOAT d2 = acx * apx + acy * apy + acz * apz;
+			const FLOAT ab2 = abx * abx + aby * aby + abz * abz;
+			const FLOAT ab_ac = abx * acx + aby * acy + abz * acz;
+			const FLOAT ac2 = acx * acx + acy * acy + acz * acz;
+			const FLOAT d3 = d1 - ab2, d4 = d2 - ab_ac;		// b to query point, onto ab and ac.
+			const FLOAT d5 = d1 - ab_ac, d6 = d2 - ac2;		// c to query point, onto ab and ac.
+			const FLOAT va = d3 * d6 - d5 * d4;
+			const FLOAT vb = d5 * d2 - d1 * d6;
+			const FLOAT vc = d1 * d4 - d3 * d2;
+
+			// Barycentric weights (v, w) of vertices b and c. Regions are selected from the lowest priority up, so the first match in Ericson's order wins.
+			const FLOAT denom = one / (va + vb + vc);
+			FLOAT v = vb * denom, w = vc * denom;												// Face
+			const FLOAT d43 = d4 - d3, d56 = d5 - d6;
+			const FLOAT on_bc = (va <= zero) & (d43 >= zero) & (d56 >= zero);
+			const FLOAT t_bc = d43 / (d43 + d56);
+			v = FLOAT::select(on_bc, one - t_bc, v); w = FLOAT::select(on_bc, t_bc, w);			// Edge bc
+			const FLOAT on_ac = (vb <= zero) & (d2 >= zero) & (d6 <= zero);
+			v = FLOAT::select(on_ac, zero, v); w = FLOAT::select(on_ac, d2 / (d2 - d6), w);		// Edge ac
+			const FLOAT on_c = (d6 >= zero) & (d5 <= d6);
+			v = FLOAT::select(on_c, zero, v); w = FLOAT::select(on_c, one, w);					// Vertex c
+			const FLOAT on_ab = (vc <= zero) & (d1 >= zero) & (d3 <= zero);
+			v = FLOAT::select(on_ab, d1 / (d1 - d3), v); w = FLOAT::select(on_ab, zero, w);		// Edge ab
+			const FLOAT on_b = (d3 >= zero) & (d4 <= d3);
+			v = FLOAT::select(on_b, one, v); w = FLOAT::select(on_b, zero, w);					// Vertex b
+			const FLOAT on_a = (d1 <= zero) & (d2 <= zero);
+			v = FLOAT::select(on_a, zero, v); w = FLOAT::select(on_a, zero, w);					// Vertex a
+
+			const FLOAT cx = ax + abx * v + acx * w, cy = ay + aby * v + acy * w, cz = az + abz * v + acz * w;
+			const FLOAT dx = px - cx, dy = py - cy, dz = pz - cz;
+			const FLOAT distance2 = dx * dx + dy * dy + dz * dz;
+			return select_closest_lane(distance2, cx, cy, cz, shortest_distance, closest_point, closest_lane);
+		}
+	};
+
+	// Triangles stored as indices into vertices shared with the mesh, in the same packet layout as an array of TrianglePacket.
+	// Each packet is gathered from the vertices into a TrianglePacket when read, trading a little time per packet for 3 indices per triangle
+	// instead of 9 floats. INDEX is uint16_t for meshes of up to 65536 vertices, else uint32_t. The vertices are referenced, not copied.
+	template<typename FLOAT, typename INDEX>
+	class IndexedTrianglePackets {
+	public:
+		static const size_t WIDTH = FLOAT::WIDTH;
+	private:
+		const Point* vertices = nullptr;
+		std::vector<INDEX> indices; // 3 per lane, WIDTH lanes per packet.
+	public:
+		IndexedTrianglePackets() = default;
+		IndexedTrianglePackets(const Point* vertices, size_t packet_count) : vertices{ vertices }, indices(packet_count * WIDTH * 3) {}
+		size_t size() const { return indices.size() / (WIDTH * 3); }
+		// Get the number of bytes held by the indices.
+		size_t memory_usage() const { return indices.capacity() * sizeof(INDEX); }
+		void set(size_t packet, size_t lane, INDEX i1, INDEX i2, INDEX i3) {
+			INDEX* triangle = &indices[(packet * WIDTH + lane) * 3];
+			triangle[0] = i1; triangle[1] = i2; triangle[2] = i3;
+		}
+		// Gather the vertices of a packet.
+		TrianglePacket<FLOAT> operator[](size_t packet) const {
+			TrianglePacket<FLOAT> triangles;
+			const INDEX* triangle = &indices[packet * WIDTH * 3];
+			for (size_t lane = 0; lane < WIDTH; ++lane, triangle += 3) triangles.set(lane, vertices[triangle[0]], vertices[triangle[1]], vertices[triangle[2]]);
+			return triangles;
+		}
+	};
+
+	// A packet of triangles with their query-independent terms precomputed, one triangle per lane of FLOAT (math::Float4 or math::Float8).
+	// Runs the same kernel as TrianglePacket, but the edge vectors, their dot products and every reciprocal are computed once at construction,
+	// so a query needs no divide or square root. The unit normal and plane offset reject the whole packet early if every plane is out of reach.
+	// Takes 20 floats per triangle instead of 9.
+	template<typename FLOAT>
+	struct alignas(sizeof(FLOAT)) PrecomputedTrianglePacket {
+		static const size_t WIDTH = FLOAT::WIDTH;
+		float a[3][WIDTH];						// Vertex a.
+		float ab[3][WIDTH], ac[3][WIDTH];		// Edges from a to b and c.
+		float normal[3][WIDTH], offset[WIDTH];	// Unit normal and its dot product with a, zero for degenerate triangles.
+		float ab2[WIDTH], ab_ac[WIDTH], ac2[WIDTH];				// Dot products of the edges.
+		float inv_ab2[WIDTH], inv_ac2[WIDTH], inv_bc2[WIDTH];	// Reciprocal squared edge lengths.
+		float inv_denom[WIDTH];									// Reciprocal squared length of the cross product of the edges.
+
+		void set(size_t lane, const Point& p1, const Point& p2, const Point& p3) {
+			const Vec3 e1 = p2 - p1, e2 = p3 - p1, cross = e1.cross(e2);
+			const Vec3 n = cross.length2() > 0.f ? cross.normalize() : Vec3(0.f);
+			for (size_t i = 0; i < 3; ++i) {
+				a[i][lane] = p1[i];
+				ab[i][lane] = e1[i];
+				ac[i][lane] = e2[i];
+				normal[i][lane] = n[i];
+			}
+			offset[lane] = n.dot(p1);
+			ab2[lane] = e1.length2(); ab_ac[lane] = e1.dot(e2); ac2[lane] = e2.length2();
+			inv_ab2[lane] = 1.f / ab2[lane]; inv_ac2[lane] = 1.f / ac2[lane]; inv_bc2[lane] = 1.f / (p3 - p2).length2();
+			inv_denom[lane] = 1.f / (ab2[lane] * ac2[lane] - ab_ac[lane] * ab_ac[lane]);
+		}
+		void get(size_t lane, Point& p1, Point& p2, Point& p3) const {
+			p1 = Point(a[0][lane], a[1][lane], a[2][lane]);
+			p2 = p1 + Vec3(ab[0][lane], ab[1][lane], ab[2][lane]);
+			p3 = p1 + Vec3(ac[0][lane], ac[1][lane], ac[2][lane]);
+		}
+		// Find the closest point on any of the triangles, only if it's closer than shortest_distance (squared). See TrianglePacket::closest_point().
+		// Return true and update shortest_distance, closest_point and the lane of the closest triangle (if not null) if a closer point is found, else false.
+		bool closest_point(const Point& query_point, float& shortest_distance, Point& closest_point, size_t* closest_lane = nullptr) const {
+			const FLOAT zero(0.f), one(1.f);
+			const FLOAT px(query_point.x()), py(query_point.y()), pz(query_point.z());
+			// The distance to the plane is a lower bound of the distance to the triangle.
+			const FLOAT plane_distance = FLOAT::load(normal[0]) * px + FLOAT::load(normal[1]) * py + FLOAT::load(normal[2]) * pz - FLOAT::load(offset);
+			if ((plane_distance * plane_distance < FLOAT(shortest_distance)).mask() == 0) return false;
+
+			const FLOAT ax = FLOAT::load(a[0]), ay = FLOAT::load(a[1]), az = FLOAT::load(a[2]);
+			const FLOAT abx = FLOAT::load(ab[0]), aby = FLOAT::load(ab[1]), abz = FLOAT::load(ab[2]);
+			const FLOAT acx = FLOAT::load(ac[0]), acy = FLOAT::load(ac[1]), acz = FLOAT::load(ac[2]);
+			const FLOAT apx = px - ax, apy = py - ay, apz = pz - az;
+			const FLOAT d1 = abx * apx + aby * apy + abz * apz;
+			const FLOAT d2 = acx * apx + acy * apy + acz * apz;
+			const FLOAT d3 = d1 - FLOAT::load(ab2), d4 = d2 - FLOAT::load(ab_ac);
+			const FLOAT d5 = d1 - FLOAT::load(ab_ac), d6 = d2 - FLOAT::load(ac2);
+			const FLOAT va = d3 * d6 - d5 * d4;
+			const FLOAT vb = d5 * d2 - d1 * d6;
+			const FLOAT vc = d1 * d4 - d3 * d2;
+
+			// Same region selection as TrianglePacket, with every divisor being a precomputed reciprocal.
+			FLOAT v = vb * FLOAT::load(inv_denom), w = vc * FLOAT::load(inv_denom);				// Face
+			const FLOAT d43 = d4 - d3, d56 = d5 - d6;
+			const FLOAT on_bc = (va <= zero) & (d43 >= zero) & (d56 >= zero);
+			const FLOAT t_bc = d43 * FLOAT::load(inv_bc2);
+			v = FLOAT::select(on_bc, one - t_bc, v); w = FLOAT::select(on_bc, t_bc, w);			// Edge bc
+			const FLOAT on_ac = (vb <= zero) & (d2 >= zero) & (d6 <= zero);
+			v = FLOAT::select(on_ac, zero, v); w = FLOAT::select(on_ac, d2 * FLOAT::load(inv_ac2), w);	// Edge ac
+			const FLOAT on_c = (d6 >= zero) & (d5 <= d6);
+			v = FLOAT::select(on_c, zero, v); w = FLOAT::select(on_c, one, w);					// Vertex c
+			const FLOAT on_ab = (vc <= zero) & (d1 >= zero) & (d3 <= zero);
+			v = FLOAT::select(on_ab, d1 * FLOAT::load(inv_ab2), v); w = FLOAT::select(on_ab, zero, w);	// Edge ab
+			const FLOAT on_b = (d3 >= zero) & (d4 <= d3);
+			v = FLOAT::select(on_b, one, v); w = FLOAT::select(on_b, zero, w);					// Vertex b
+			const FLOAT on_a = (d1 <= zero) & (d2 <= zero);
+			v = FLOAT::select(on_a, zero, v); w = FLOAT::select(on_a, zero, w);					// Vertex a
+
+			const FLOAT cx = ax + abx * v + acx * w, cy = ay + aby * v + acy * w, cz = az + abz * v + acz * w;
+			const FLOAT dx = px - cx, dy = py - cy, dz = pz - cz;
+			return select_closest_lane(dx * dx + dy * dy + dz * dz, cx, cy, cz, shortest_distance, closest_point, closest_lane);
+		}
+	};
+
+	// A packet of triangles each stored with a rigid transform into its own 2D frame, one triangle per lane of FLOAT (math::Float4 or math::Float8).
+	// Following M. W. Jones, 3D Distance from a Point to a Triangle, 1995. Vertex a sits at the origin, edge ab along the x axis and the triangle
+	// in the xy-plane with vertex c above the x axis. The transformed query point gives the distance to the plane as its z coordinate,
+	// the rest is a 2D problem: inside the triangle, or else the clamped projection onto the closest edge.
+	// Degenerate triangles have no frame and are never reported, like closest_point_on_triangle(). Takes 18 floats per triangle.
+	template<typename FLOAT>
+	struct alignas(sizeof(FLOAT)) JonesTrianglePacket {
+		static const size_t WIDTH = FLOAT::WIDTH;
+		float a[3][WIDTH];							// Vertex a, the origin of the frame.
+		float axes[3][3][WIDTH];					// Rows of the rotation into the frame, i.e. the unit x, y and z axes of the frame in world space.
+		float bx[WIDTH], inv_bx[WIDTH];				// Vertex b in the frame is (bx, 0).
+		float c[2][WIDTH];							// Vertex c in the frame, with c[1] > 0.
+		float inv_c2[WIDTH], inv_bc2[WIDTH];		// Reciprocal squared lengths of edges ca and bc.
+
+		void set(size_t lane, const Point& p1, const Point& p2, const Point& p3) {
+			const Vec3 ab = p2 - p1, ac = p3 - p1, cross = ab.cross(ac);
+			const float nan = std::numeric_limits<float>::quiet_NaN();
+			const bool degenerate = !(cross.length2() > 0.f);
+			const Vec3 x_axis = degenerate ? Vec3(nan) : ab.normalize();
+			const Vec3 z_axis = degenerate ? Vec3(nan) : cross.normalize();
+			const Vec3 y_axis = z_axis.cross(x_axis);
+			const Vec3 frame[3] = { x_axis, y_axis, z_axis };
+			for (size_t i = 0; i < 3; ++i) {
+				a[i][lane] = p1[i];
+				for (size_t j = 0; j < 3; ++j) axes[i][j][lane] = frame[i][j];
+			}
+			bx[lane] = ab.length(); inv_bx[lane] = 1.f / bx[lane];
+			c[0][lane] = x_axis.dot(ac); c[1][lane] = y_axis.dot(ac);
+			inv_c2[lane] = 1.f / ac.length2(); inv_bc2[lane] = 1.f / (p3 - p2).length2();
+		}
+		// The vertices are transformed back from the frame, so they may differ from the ones set in the last bits.
+		void get(size_t lane, Point& p1, Point& p2, Point& p3) const {
+			const Vec3 x_axis(axes[0][0][lane], axes[0][1][lane], axes[0][2][lane]), y_axis(axes[1][0][lane], axes[1][1][lane], axes[1][2][lane]);
+			p1 = Point(a[0][lane], a[1][lane], a[2][lane]);
+			p2 = p1 + x_axis * bx[lane];
+			p3 = p1 + x_axis * c[0][lane] + y_axis * c[1][lane];
+		}
+		// Find the closest point on any of the triangles, only if it's closer than shortest_distance (squared).
+		// Return true and update shortest_distance, closest_point and the lane of the closest triangle (if not null) if a closer point is found, else false.
+		bool closest_point(const Point& query_point, float& shortest_distance, Point& closest_point, size_t* closest_lane = nullptr) const {
+			const FLOAT zero(0.f), one(1.f);
+			const FLOAT ax = FLOAT::load(a[0]), ay = FLOAT::load(a[1]), az = FLOAT::load(a[2]);
+			const FLOAT apx = FLOAT(query_point.x()) - ax, apy = FLOAT(query_point.y()) - ay, apz = FLOAT(query_point.z()) - az;
+			// Transform into the frame, z is the signed distance to the plane.
+			const FLOAT z = FLOAT::load(axes[2][0]) * apx + FLOAT::load(axes[2][1]) * apy + FLOAT::load(axes[2][2]) * apz;
+			const FLOAT z2 = z * z;
+			if ((z2 < FLOAT(shortest_distance)).mask() == 0) return false;
+			const FLOAT x = FLOAT::load(axes[0][0]) * apx + FLOAT::load(axes[0][1]) * apy + FLOAT::load(axes[0][2]) * apz;
+			const FLOAT y = FLOAT::load(axes[1][0]) * apx + FLOAT::load(axes[1][1]) * apy + FLOAT::load(axes[1][2]) * apz;
+
+			// Clamped projections onto the 3 edges, keeping the closest one as (u, v) in the frame.
+			const FLOAT b = FLOAT::load(bx), cx = FLOAT::load(c[0]), cy = FLOAT::load(c[1]);
+			const FLOAT t_ab = (x * FLOAT::load(inv_bx)).max(zero).min(one);
+			FLOAT u = t_ab * b, v = zero;
+			FLOAT edge_distance2 = (x - u) * (x - u) + y * y;
+			const FLOAT bcx = cx - b, qx = x - b;
+			const FLOAT t_bc = ((qx * bcx + y * cy) * FLOAT::load(inv_bc2)).max(zero).min(one);
+			const FLOAT u_bc = b + t_bc * bcx, v_bc = t_bc * cy;
+			const FLOAT bc_distance2 = (x - u_bc) * (x - u_bc) + (y - v_bc) * (y - v_bc);
+			const FLOAT closer_bc = bc_distance2 < edge_distance2;
+			u = FLOAT::select(closer_bc, u_bc, u); v = FLOAT::select(closer_bc, v_bc, v); edge_distance2 = edge_distance2.min(bc_distance2);
+			const FLOAT t_ca = ((x * cx + y * cy) * FLOAT::load(inv_c2)).max(zero).min(one);
+			const FLOAT u_ca = t_ca * cx, v_ca = t_ca * cy;
+			const FLOAT ca_distance2 = (x - u_ca) * (x - u_ca) + (y - v_ca) * (y - v_ca);
+			const FLOAT closer_ca = ca_distance2 < edge_distance2;
+			u = FLOAT::select(closer_ca, u_ca, u); v = FLOAT::select(closer_ca, v_ca, v); edge_distance2 = edge_distance2.min(ca_distance2);
+
+			// Inside when left of every edge of the counter-clockwise triangle, the projection onto the plane is the closest point.
+			const FLOAT inside = (y >= zero) & (bcx * y - cy * qx >= zero) & (cy * x - cx * y >= zero);
+			u = FLOAT::select(inside, x, u); v = FLOAT::select(inside, y, v);
+			const FLOAT distance2 = FLOAT::select(inside, zero, edge_distance2) + z2;
+
+			// Transform back to world space.
+			const FLOAT closest_x = ax + FLOAT::load(axes[0][0]) * u + FLOAT::load(axes[1][0]) * v;
+			const FLOAT closest_y = ay + FLOAT::load(axes[0][1]) * u + FLOAT::load(axes[1][1]) * v;
+			const FLOAT closest_z = az + FLOAT::load(axes[0][2]) * u + FLOAT::load(axes[1][2]) * v;
+			return select_closest_lane(distance2, closest_x, closest_y, closest_z, shortest_distance, closest_point, closest_lane);
+		}
+	};
+
+} // namespace geoutils
@@ -1,55 +1,180 @@
 #pragma once
-#include <intrin.h>
+#include <cmath>
 #include <limits>
+#include "Platform.h"
 
 namespace math {
 
-	class alignas(16) Vec3 {
+	// Every backend below shares the same interface, math::Vec3 is the one selected for the target in Platform.h.
+	// Horizontal operations sum the lanes in the order x, y, z so that the backends agree bit for bit on dot products.
+
+	// A portable 3D vector without any intrinsics.
+	class alignas(16) ScalarVec3 {
+	private:
+		float _data[4];
+	public:
+		ScalarVec3() : _data{ 0.f, 0.f, 0.f, 0.f } {}
+		ScalarVec3(float val) : _data{ val, val, val, 0.f } {}
+		ScalarVec3(float x, float y, float z) : _data{ x, y, z, 0.f } {}
+		// Load 3 consecutive floats, without reading past them.
+		static ScalarVec3 load3(const float* xyz) { return ScalarVec3(xyz[0], xyz[1], xyz[2]); }
+		ScalarVec3 operator+(const ScalarVec3& other) const { return ScalarVec3(_data[0] + other._data[0], _data[1] + other._data[1], _data[2] + other._data[2]); }
+		ScalarVec3 operator-(const ScalarVec3& other) const { return ScalarVec3(_data[0] - other._data[0], _data[1] - other._data[1], _data[2] - other._data[2]); }
+		ScalarVec3 operator*(const ScalarVec3& other) const { return ScalarVec3(_data[0] * other._data[0], _data[1] * other._data[1], _data[2] * other._data[2]); }
+		ScalarVec3 operator/(const ScalarVec3& other) const { return ScalarVec3(_data[0] / other._data[0], _data[1] / other._data[1], _data[2] / other._data[2]); }
+		ScalarVec3 operator-() const { return ScalarVec3(-_data[0], -_data[1], -_data[2]); }
+		ScalarVec3 operator*(float scalar) const { return ScalarVec3(_data[0] * scalar, _data[1] * scalar, _data[2] * scalar); }
+		bool operator==(const ScalarVec3& other) const { return _data[0] == other._data[0] && _data[1] == other._data[1] && _data[2] == other._data[2]; }
+		bool operator!=(const ScalarVec3& other) const { return !(*this == other); }
+		float operator[](size_t idx) const { return _data[idx]; }
+		bool nearly_zero() const { return length() < std::numeric_limits<float>::epsilon(); }
+		float x() const { return _data[0]; }
+		float y() const { return _data[1]; }
+		float z() const { return _data[2]; }
+		float dot(const ScalarVec3& other) const { return _data[0] * other._data[0] + _data[1] * other._data[1] + _data[2] * other._data[2]; }
+		float length() const { return sqrtf(length2()); }
+		float length2() const { return dot(*this); }
+		float distance(const ScalarVec3& other) const { return (*this - other).length(); }
+		float distance2(const ScalarVec3& other) const { return (*this - other).length2(); }
+		// Same NaN behaviour as _mm_min_ps and _mm_max_ps, the second operand is returned when unordered.
+		ScalarVec3 min(const ScalarVec3& other) const { return ScalarVec3(_data[0] < other._data[0] ? _data[0] : other._data[0], _data[1] < other._data[1] ? _data[1] : other._data[1], _data[2] < other._data[2] ? _data[2] : other._data[2]); }
+		ScalarVec3 max(const ScalarVec3& other) const { return ScalarVec3(_data[0] > other._data[0] ? _data[0] : other._data[0], _data[1] > other._data[1] ? _data[1] : other._data[1], _data[2] > other._data[2] ? _data[2] : other._data[2]); }
+		ScalarVec3 normalize() const { const float len = length(); return ScalarVec3(_data[0] / len, _data[1] / len, _data[2] / len); }
+		ScalarVec3 cross(const ScalarVec3& other) const {
+			return ScalarVec3(
+				_data[1] * other._data[2] - _data[2] * other._data[1],
+				_data[2] * other._data[0] - _data[0] * other._data[2],
+				_data[0] * other._data[1] - _data[1] * other._data[0]
+			);
+		}
+	};
+
+#if defined(MATH_HAS_SSE4)
+	// A 3D vector stored in an SSE register, the 4th lane is kept at zero.
+	class alignas(16) SseVec3 {
 	private:
 		__m128 _data;
 	public:
-		Vec3() : _data{ _mm_setr_ps(0.f, 0.f, 0.f, 0.f) } {}
-		Vec3(float val) : _data{ _mm_set_ps1(val) } {}
-		Vec3(float x, float y, float z) : _data{ _mm_setr_ps(x, y, z, 0.f) } {}
-		Vec3(const Vec3& other) : _data{ other._data } {}
-		~Vec3() = default;
-		Vec3& operator=(const Vec3& other) { if (this == &other) return *this; _data = other._data; return *this; }
-		Vec3 operator+(const Vec3& other) const { return Vec3(_mm_add_ps(_data, other._data)); }
-		Vec3 operator-(const Vec3& other) const { return Vec3(_mm_sub_ps(_data, other._data)); }
-		Vec3 operator*(const Vec3& other) const { return Vec3(_mm_mul_ps(_data, other._data)); }
-		Vec3 operator/(const Vec3& other) const { return Vec3(_mm_div_ps(_data, other._data)); }
-		Vec3 operator-() const { return Vec3(_mm_sub_ps(_mm_set1_ps(0.f), _data)); }
-		Vec3 operator*(float scalar) const { return Vec3(_mm_mul_ps(_data, _mm_set_ps1(scalar))); }
-		bool operator==(const Vec3& other) const { return _mm_movemask_ps(_mm_cmpeq_ps(_data, other._data)) & 0xE; }
-		bool operator!=(const Vec3& other) const { return !(*this == other); }
-		const float& operator[](size_t idx) const { return _data.m128_f32[idx]; }
+		SseVec3() : _data{ _mm_setzero_ps() } {}
+		SseVec3(float val) : _data{ _mm_setr_ps(val, val, val, 0.f) } {}
+		SseVec3(float x, float y, float z) : _data{ _mm_setr_ps(x, y, z, 0.f) } {}
+		// Load 3 consecutive floats, without reading past them: x and y as one 64-bit load, z into the low lane of another.
+		static SseVec3 load3(const float* xyz) { return SseVec3(_mm_movelh_ps(_mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(xyz))), _mm_load_ss(xyz + 2))); }
+		SseVec3 operator+(const SseVec3& other) const { return SseVec3(_mm_add_ps(_data, other._data)); }
+		SseVec3 operator-(const SseVec3& other) const { return SseVec3(_mm_sub_ps(_data, other._data)); }
+		SseVec3 operator*(const SseVec3& other) const { return SseVec3(_mm_mul_ps(_data, other._data)); }
+		SseVec3 operator/(const SseVec3& other) const { return SseVec3(_mm_div_ps(_data, other._data)); }
+		SseVec3 operator-() const { return SseVec3(_mm_sub_ps(_mm_setzero_ps(), _data)); }
+		SseVec3 operator*(float scalar) const { return SseVec3(_mm_mul_ps(_data, _mm_set_ps1(scalar))); }
+		bool operator==(const SseVec3& other) const { return (_mm_movemask_ps(_mm_cmpeq_ps(_data, other._data)) & 0x7) == 0x7; }
+		bool operator!=(const SseVec3& other) const { return !(*this == other); }
+		float operator[](size_t idx) const { alignas(16) float lanes[4]; _mm_store_ps(lanes, _data); return lanes[idx]; }
 		bool nearly_zero() const { return length() < std::numeric_limits<float>::epsilon(); }
-		float x() const { return _data.m128_f32[0]; }
-		float y() const { return _data.m128_f32[1]; }
-		float z() const { return _data.m128_f32[2]; }
-		float dot(const Vec3& other) const { return _mm_dp_ps(_data, other._data, 0x78).m128_f32[3]; }
-		float length() const { return sqrtf(_mm_dp_ps(_data, _data, 0x78).m128_f32[3]); }
-		float length2() const { return _mm_dp_ps(_data, _data, 0x78).m128_f32[3]; }
-		float distance(const Vec3& other) const { return (*this - other).length(); }
-		float distance2(const Vec3& other) const { return (*this - other).length2(); }
-		Vec3 min(const Vec3& other) const { return Vec3(_mm_min_ps(_data, other._data)); }
-		Vec3 max(const Vec3& other) const { return Vec3(_mm_max_ps(_data, other._data)); }
-		Vec3 normalize() const {
-			const __m128 length = _mm_sqrt_ps(_mm_dp_ps(_data, _data, 0x77));
-			return Vec3(_mm_mul_ps(_data, _mm_div_ps(_mm_set_ps1(1.0f), length)));
+		float x() const { return _mm_cvtss_f32(_data); }
+		float y() const { return _mm_cvtss_f32(_mm_shuffle_ps(_data, _data, _MM_SHUFFLE(1, 1, 1, 1))); }
+		float z() const { return _mm_cvtss_f32(_mm_movehl_ps(_data, _data)); }
+		// Multiply then add the lanes with scalar adds, _mm_dp_ps has a long latency on most cores.
+		float dot(const SseVec3& other) const {
+			const __m128 product = _mm_mul_ps(_data, other._data);
+			const __m128 xy = _mm_add_ss(product, _mm_shuffle_ps(product, product, _MM_SHUFFLE(1, 1, 1, 1)));
+			return _mm_cvtss_f32(_mm_add_ss(xy, _mm_movehl_ps(product, product)));
 		}
-		Vec3 cross(const Vec3& other) const {
+		float length() const { return sqrtf(length2()); }
+		float length2() const { return dot(*this); }
+		float distance(const SseVec3& other) const { return (*this - other).length(); }
+		float distance2(const SseVec3& other) const { return (*this - other).length2(); }
+		SseVec3 min(const SseVec3& other) const { return SseVec3(_mm_min_ps(_data, other._data)); }
+		SseVec3 max(const SseVec3& other) const { return SseVec3(_mm_max_ps(_data, other._data)); }
+		// A division rather than a multiplication by the reciprocal, keeping the result correctly rounded.
+		SseVec3 normalize() const { return SseVec3(_mm_div_ps(_data, _mm_set_ps1(length()))); }
+		SseVec3 cross(const SseVec3& other) const {
 			const __m128 tmp0 = _mm_shuffle_ps(_data, _data, _MM_SHUFFLE(3, 0, 2, 1));
 			const __m128 tmp1 = _mm_shuffle_ps(other._data, other._data, _MM_SHUFFLE(3, 1, 0, 2));
 			const __m128 tmp2 = _mm_shuffle_ps(_data, _data, _MM_SHUFFLE(3, 1, 0, 2));
 			const __m128 tmp3 = _mm_shuffle_ps(other._data, other._data, _MM_SHUFFLE(3, 0, 2, 1));
-			return _mm_sub_ps(
-				_mm_mul_ps(tmp0, tmp1),
-				_mm_mul_ps(tmp2, tmp3)
-			);
+#if defined(MATH_HAS_FMA)
+			return SseVec3(_mm_fmsub_ps(tmp0, tmp1, _mm_mul_ps(tmp2, tmp3)));
+#else
+			return SseVec3(_mm_sub_ps(_mm_mul_ps(tmp0, tmp1), _mm_mul_ps(tmp2, tmp3)));
+#endif
+		}
+	private:
+		SseVec3(const __m128& _data) : _data{ _data } {}
+	};
+#endif
+
+#if defined(MATH_HAS_NEON)
+	// A 3D vector stored in a NEON register, the 4th lane is kept at zero.
+	class alignas(16) NeonVec3 {
+	private:
+		float32x4_t _data;
+	public:
+		NeonVec3() : _data{ vdupq_n_f32(0.f) } {}
+		NeonVec3(float val) : _data{ vsetq_lane_f32(0.f, vdupq_n_f32(val), 3) } {}
+		NeonVec3(float x, float y, float z) { const float lanes[4] = { x, y, z, 0.f }; _data = vld1q_f32(lanes); }
+		// Load 3 consecutive floats, without reading past them.
+		static NeonVec3 load3(const float* xyz) { return NeonVec3(vcombine_f32(vld1_f32(xyz), vset_lane_f32(xyz[2], vdup_n_f32(0.f), 0))); }
+		NeonVec3 operator+(const NeonVec3& other) const { return NeonVec3(vaddq_f32(_data, other._data)); }
+		NeonVec3 operator-(const NeonVec3& other) const { return NeonVec3(vsubq_f32(_data, other._data)); }
+		NeonVec3 operator*(const NeonVec3& other) const { return NeonVec3(vmulq_f32(_data, other._data)); }
+		NeonVec3 operator/(const NeonVec3& other) const { return NeonVec3(vdivq_f32(_data, other._data)); }
+		NeonVec3 operator-() const { return NeonVec3(vnegq_f32(_data)); }
+		NeonVec3 operator*(float scalar) const { return NeonVec3(vmulq_n_f32(_data, scalar)); }
+		bool operator==(const NeonVec3& other) const { return vminvq_u32(vsetq_lane_u32(0xFFFFFFFFu, vceqq_f32(_data, other._data), 3)) != 0; }
+		bool operator!=(const NeonVec3& other) const { return !(*this == other); }
+		float operator[](size_t idx) const { float lanes[4]; vst1q_f32(lanes, _data); return lanes[idx]; }
+		bool nearly_zero() const { return length() < std::numeric_limits<float>::epsilon(); }
+		float x() const { return vgetq_lane_f32(_data, 0); }
+		float y() const { return vgetq_lane_f32(_data, 1); }
+		float z() const { return vgetq_lane_f32(_data, 2); }
+		float dot(const NeonVec3& other) const {
+			const float32x4_t product = vmulq_f32(_data, other._data);
+			return vgetq_lane_f32(product, 0) + vgetq_lane_f32(product, 1) + vgetq_lane_f32(product, 2);
+		}
+		float length() const { return sqrtf(length2()); }
+		float length2() const { return dot(*this); }
+		float distance(const NeonVec3& other) const { return (*this - other).length(); }
+		float distance2(const NeonVec3& other) const { return (*this - other).length2(); }
+		NeonVec3 min(const NeonVec3& other) const { return NeonVec3(vminq_f32(_data, other._data)); }
+		NeonVec3 max(const NeonVec3& other) const { return NeonVec3(vmaxq_f32(_data, other._data)); }
+		NeonVec3 normalize() const { return NeonVec3(vdivq_f32(_data, vdupq_n_f32(length()))); }
+		NeonVec3 cross(const NeonVec3& other) const {
+			// Rotate the lanes to (y, z, x, w), NEON has no single instruction for arbitrary shuffles of 32-bit lanes.
+			const float32x4_t a_yzx = vsetq_lane_f32(vgetq_lane_f32(_data, 0), vextq_f32(_data, _data, 1), 2);
+			const float32x4_t b_yzx = vsetq_lane_f32(vgetq_lane_f32(other._data, 0), vextq_f32(other._data, other._data, 1), 2);
+			const float32x4_t c = vsubq_f32(vmulq_f32(_data, b_yzx), vmulq_f32(a_yzx, other._data));
+			// c holds the cross product in (z, x, y) order.
+			const float32x4_t c_yzx = vsetq_lane_f32(vgetq_lane_f32(c, 0), vextq_f32(c, c, 1), 2);
+			return NeonVec3(vsetq_lane_f32(0.f, c_yzx, 3));
 		}
 	private:
-		Vec3(const __m128& _data) : _data{ _data } {}
+		NeonVec3(const float32x4_t& _data) : _data{ _data } {}
+	};
+#endif
+
+#if defined(MATH_BACKEND_SSE4)
+	using Vec3 = SseVec3;
+#elif defined(MATH_BACKEND_NEON)
+	using Vec3 = NeonVec3;
+#else
+	using Vec3 = ScalarVec3;
+#endif
+
+	// A 3D vector packed into 12 bytes for bulk storage, converted from and to Vec3 where it's used.
+	class PackedVec3 {
+	private:
+		float _data[3];
+	public:
+		PackedVec3() : _data{ 0.f, 0.f, 0.f } {}
+		PackedVec3(float x, float y, float z) : _data{ x, y, z } {}
+		PackedVec3(const Vec3& v) : _data{ v.x(), v.y(), v.z() } {}
+		operator Vec3() const { return Vec3::load3(_data); }
+		bool operator==(const PackedVec3& other) const { return _data[0] == other._data[0] && _data[1] == other._data[1] && _data[2] == other._data[2]; }
+		bool operator!=(const PackedVec3& other) const { return !(*this == other); }
+		float x() const { return _data[0]; }
+		float y() const { return _data[1]; }
+		float z() const { return _data[2]; }
 	};
+	static_assert(sizeof(PackedVec3) == 12, "PackedVec3 must not be padded");
 
-}; // namespace math
\ No newline at end of file
+}; // namespace math
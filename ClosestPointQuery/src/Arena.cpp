@@ -0,0 +1,37 @@
+#include <cassert>
+#include "Platform.h"
+#include "Arena.h"
+
+namespace geoutils {
+
+	Arena::~Arena() {
+		for (void* block : blocks) math::aligned_free(block);
+	}
+
+	void* Arena::allocate(size_t size, size_t alignment) {
+		assert(alignment > 0 && alignment <= BLOCK_ALIGNMENT && (alignment & (alignment - 1)) == 0 && "Invalid alignment.");
+		std::lock_guard<std::mutex> lock(mutex);
+		// Large allocations get a block of their own, so that the rest of the current block isn't wasted.
+		if (size > block_size / 4) {
+			void* block = math::aligned_malloc(size, BLOCK_ALIGNMENT);
+			if (block == nullptr) throw std::bad_alloc();
+			blocks.push_back(block);
+			reserved += size;
+			return block;
+		}
+		size_t padding = (alignment - reinterpret_cast<size_t>(cursor) % alignment) % alignment;
+		if (cursor == nullptr || padding + size > remaining) {
+			cursor = static_cast<char*>(math::aligned_malloc(block_size, BLOCK_ALIGNMENT));
+			if (cursor == nullptr) throw std::bad_alloc();
+			blocks.push_back(cursor);
+			remaining = block_size;
+			reserved += block_size;
+			padding = 0;
+		}
+		void* ptr = cursor + padding;
+		cursor += padding + size;
+		remaining -= padding + size;
+		return ptr;
+	}
+
+} // namespace geoutils
@@ -2,78 +2,460 @@
 
 namespace geoutils {
 
-	ClosestPointQuery::ClosestPointQuery(const Mesh& m) {
-		// Construct the R-Tree
+	// Number of triangles gathered per parallel task during construction.
+	const size_t CONSTRUCTION_CHUNK_SIZE = 16384;
+	// Number of query points claimed at a time by a thread of query_batch, large enough to amortize the scheduling.
+	const size_t QUERY_CHUNK_SIZE = 256;
+	// Number of samples along each axis of a tile of bake_grid, the samples of a tile share the buckets gathered from the tree.
+	const size_t GRID_TILE_SIZE = 4;
+
+	// Give the samples of a signed bake_grid outside the band the sign of the band samples they are connected to.
+	// Negative samples within the band flip their out-of-band neighbours, which in turn flip theirs, the rest stay positive.
+	// No edge between neighbouring samples crosses the surface while the cells are smaller than the band, see GridOptions::max_dist.
+	static void flood_band_signs(const size_t (&resolution)[3], std::vector<uint8_t>& out_of_band, Span<float> distances) {
+		const size_t slice = resolution[0] * resolution[1];
+		std::vector<size_t> queue;
+		for (size_t i = 0; i < distances.size(); ++i) {
+			if (!out_of_band[i] && distances[i] < 0.f) queue.push_back(i);
+		}
+		for (size_t head = 0; head < queue.size(); ++head) {
+			const size_t i = queue[head];
+			const size_t x = i % resolution[0], y = i / resolution[0] % resolution[1], z = i / slice;
+			const size_t neighbours[6] = {
+				x > 0 ? i - 1 : SIZE_MAX, x + 1 < resolution[0] ? i + 1 : SIZE_MAX,
+				y > 0 ? i - resolution[0] : SIZE_MAX, y + 1 < resolution[1] ? i + resolution[0] : SIZE_MAX,
+				z > 0 ? i - slice : SIZE_MAX, z + 1 < resolution[2] ? i + slice : SIZE_MAX,
+			};
+			for (size_t neighbour : neighbours) {
+				if (neighbour == SIZE_MAX || !out_of_band[neighbour]) continue;
+				out_of_band[neighbour] = false; // Flipped once, as it's queued.
+				distances[neighbour] = -distances[neighbour];
+				queue.push_back(neighbour);
+			}
+		}
+	}
+
+	ClosestPointQuery::ClosestPointQuery(const Mesh& m, const BuildOptions& options) {
+		build(m, options);
+	}
+
+	ClosestPointQuery::ClosestPointQuery(Mesh&& m, const BuildOptions& options) {
+		owned_mesh.reset(new Mesh(std::move(m)));
+		build(*owned_mesh, options);
+	}
+
+	void ClosestPointQuery::build(const Mesh& m, const BuildOptions& options) {
+		ThreadPool& thread_pool = options.thread_pool != nullptr ? *options.thread_pool : ThreadPool::global();
 		const size_t triangle_count = m.indices.size() / 3;
-		triangles.reserve(triangle_count);
-		for (size_t i = 0; i < m.indices.size(); i += 3) {
-			const auto& p1 = m.vertices[m.indices[i + 0]];
-			const auto& p2 = m.vertices[m.indices[i + 1]];
-			const auto& p3 = m.vertices[m.indices[i + 2]];
-			triangles.emplace_back(p1, p2, p3);
-			const Vec3 min = p1.min(p2).min(p3);
-			const Vec3 max = p1.max(p2).max(p3);
-			r_star_tree.insert(min, max, &triangles.back());
+		assert(triangle_count < UINT32_MAX && "Too many triangles for 32-bit indices.");
+		mesh = &m;
+		const auto vertex = [&](size_t triangle, size_t i) -> const Point& { return m.vertices[m.indices[triangle * 3 + i]]; };
+
+		// Order the triangles along the Z-order curve of their centroids, so that consecutive triangles are spatially close.
+		const size_t chunk_count = (triangle_count + CONSTRUCTION_CHUNK_SIZE - 1) / CONSTRUCTION_CHUNK_SIZE;
+		std::vector<BoundingBox> chunk_bounds(chunk_count);
+		thread_pool.parallel_for(chunk_count, [&](size_t chunk) {
+			const size_t end = std::min((chunk + 1) * CONSTRUCTION_CHUNK_SIZE, triangle_count);
+			for (size_t i = chunk * CONSTRUCTION_CHUNK_SIZE; i < end; ++i) {
+				const Point centroid = (vertex(i, 0) + vertex(i, 1) + vertex(i, 2)) * (1.f / 3.f);
+				chunk_bounds[chunk].enlarge(BoundingBox{ centroid, centroid });
+			}
+		});
+		BoundingBox centroid_bound;
+		for (const BoundingBox& b : chunk_bounds) centroid_bound.enlarge(b);
+		std::vector<std::pair<uint32_t, uint32_t>> order(triangle_count); // Morton code and index of each triangle.
+		thread_pool.parallel_for(chunk_count, [&](size_t chunk) {
+			const size_t end = std::min((chunk + 1) * CONSTRUCTION_CHUNK_SIZE, triangle_count);
+			for (size_t i = chunk * CONSTRUCTION_CHUNK_SIZE; i < end; ++i) {
+				const Point centroid = (vertex(i, 0) + vertex(i, 1) + vertex(i, 2)) * (1.f / 3.f);
+				order[i] = { morton_code(centroid, centroid_bound), static_cast<uint32_t>(i) };
+			}
+		});
+		std::sort(order.begin(), order.end());
+		ordered_triangles.resize(triangle_count);
+		for (size_t i = 0; i < triangle_count; ++i) ordered_triangles[i] = order[i].second;
+
+		// Slice the ordered triangles into buckets of leaf_size, each bucket becomes a leaf of the tree.
+		leaf_size = std::max<size_t>(options.leaf_size, 1);
+		const size_t bucket_count = (triangle_count + leaf_size - 1) / leaf_size;
+		const size_t buckets_per_chunk = std::max<size_t>(CONSTRUCTION_CHUNK_SIZE / leaf_size, 1);
+		std::vector<std::pair<BoundingBox, uint32_t>> entries(bucket_count);
+		thread_pool.parallel_for((bucket_count + buckets_per_chunk - 1) / buckets_per_chunk, [&](size_t chunk) {
+			const size_t end = std::min((chunk + 1) * buckets_per_chunk, bucket_count);
+			for (size_t bucket = chunk * buckets_per_chunk; bucket < end; ++bucket) {
+				BoundingBox bound;
+				for (size_t i = bucket * leaf_size; i < std::min((bucket + 1) * leaf_size, triangle_count); ++i) {
+					const auto& p1 = vertex(ordered_triangles[i], 0);
+					const auto& p2 = vertex(ordered_triangles[i], 1);
+					const auto& p3 = vertex(ordered_triangles[i], 2);
+					bound.enlarge(BoundingBox{ p1.min(p2).min(p3), p1.max(p2).max(p3) });
+				}
+				entries[bucket] = { bound, static_cast<uint32_t>(bucket) };
+			}
+		});
+		switch (options.kernel) {
+		case TriangleKernel::Precomputed: pack_buckets(precomputed_packets, m, ordered_triangles, leaf_size, thread_pool); break;
+		case TriangleKernel::Jones: pack_buckets(jones_packets, m, ordered_triangles, leaf_size, thread_pool); break;
+		case TriangleKernel::Indexed:
+			if (m.vertices.size() <= 65536) pack_buckets(indexed_packets16, m, ordered_triangles, leaf_size, thread_pool);
+			else pack_buckets(indexed_packets32, m, ordered_triangles, leaf_size, thread_pool);
+			break;
+		default: pack_buckets(triangle_packets, m, ordered_triangles, leaf_size, thread_pool); break;
 		}
+
+		// Construct the R-Tree over the buckets
+		RStarTree<uint32_t, 64> tree;
+		if (options.construction == TreeConstruction::Incremental) {
+			for (const auto& entry : entries) tree.insert(entry.first.min, entry.first.max, entry.second);
+		}
+		else {
+			tree.bulk_load(entries, &thread_pool);
+		}
+
+		// The tree is read-only from now on, flatten it for faster queries.
+		r_star_tree = FrozenRStarTree<uint32_t, 64>(tree, options.node_bounds);
+		if (options.pseudo_normals) compute_pseudo_normals(m, thread_pool);
+	}
+
+	void ClosestPointQuery::compute_pseudo_normals(const Mesh& m, ThreadPool& thread_pool) {
+		const size_t triangle_count = m.indices.size() / 3;
+		const auto unit = [](const Vec3& v) { return v.length2() > 0.f ? v.normalize() : Vec3(0.f); };
+		pseudo_normals.assign(triangle_count * 7, PackedVec3());
+
+		// Face normals and the angle at each corner of the triangles.
+		std::vector<float> angles(triangle_count * 3);
+		const size_t chunk_count = (triangle_count + CONSTRUCTION_CHUNK_SIZE - 1) / CONSTRUCTION_CHUNK_SIZE;
+		thread_pool.parallel_for(chunk_count, [&](size_t chunk) {
+			const size_t end = std::min((chunk + 1) * CONSTRUCTION_CHUNK_SIZE, triangle_count);
+			for (size_t i = chunk * CONSTRUCTION_CHUNK_SIZE; i < end; ++i) {
+				const Point p[3] = { m.vertices[m.indices[i * 3]], m.vertices[m.indices[i * 3 + 1]], m.vertices[m.indices[i * 3 + 2]] };
+				pseudo_normals[i * 7] = unit((p[1] - p[0]).cross(p[2] - p[0]));
+				for (size_t j = 0; j < 3; ++j) {
+					const float cosine = unit(p[(j + 1) % 3] - p[j]).dot(unit(p[(j + 2) % 3] - p[j]));
+					angles[i * 3 + j] = acosf(std::min(std::max(cosine, -1.f), 1.f));
+				}
+			}
+		});
+
+		// An edge takes the sum of the normals of the faces sharing it, found next to each other once the edges are sorted by their vertices.
+		std::vector<std::pair<uint64_t, uint32_t>> edges(triangle_count * 3); // Lower and higher vertex index of each edge, and the edge as i * 3 + j.
+		for (size_t i = 0; i < triangle_count * 3; ++i) {
+			const uint32_t a = m.indices[i], b = m.indices[i % 3 == 2 ? i - 2 : i + 1];
+			edges[i] = { static_cast<uint64_t>(std::min(a, b)) << 32 | std::max(a, b), static_cast<uint32_t>(i) };
+		}
+		std::sort(edges.begin(), edges.end());
+		for (size_t first = 0, last = 0; first < edges.size(); first = last) {
+			Vec3 sum(0.f);
+			for (last = first; last < edges.size() && edges[last].first == edges[first].first; ++last) sum = sum + pseudo_normals[edges[last].second / 3 * 7];
+			for (size_t k = first; k < last; ++k) pseudo_normals[edges[k].second / 3 * 7 + 1 + edges[k].second % 3] = unit(sum);
+		}
+
+		// A vertex takes the sum of the normals of the faces around it, weighted by their angle at the vertex.
+		std::vector<Vec3> vertex_normals(m.vertices.size(), Vec3(0.f));
+		for (size_t i = 0; i < triangle_count * 3; ++i) vertex_normals[m.indices[i]] = vertex_normals[m.indices[i]] + Vec3(pseudo_normals[i / 3 * 7]) * angles[i];
+		for (size_t i = 0; i < triangle_count * 3; ++i) pseudo_normals[i / 3 * 7 + 4 + i % 3] = unit(vertex_normals[m.indices[i]]);
 	}
 
 	bool ClosestPointQuery::operator() (const Point& query_point, float max_dist, Point& closest_point) const {
-		// First, get the bounding box of the radius positioned at query point.
-		double shortest_distance = DBL_MAX;
-		const Point search_min(query_point - Vec3(max_dist));
-		const Point search_max(query_point + Vec3(max_dist));
-		const auto search_callback = [&](Triangle* tri) -> bool {
-			uint8_t outside_count = 0;
-			// Determine the triangle normal and projected point.
-			const auto& vert = tri->vertices;
-			const Vec3 normal = (vert[1] - vert[0]).cross(vert[2] - vert[0]).normalize();
-			const Vec3 projection = normal * (vert[0] - query_point).dot(normal);
-			const double distance_to_plane = projection.length2();
-
-			// Early termination. (distance_to_plane is already the shortest possible distance to the triangle, there's no reason to proceed)
-			if (distance_to_plane > shortest_distance) return true;
-
-			const Point projected = query_point + projection;
-			for (uint8_t i = 0; i < 3; ++i) {
-				const Point& v1 = vert[i];
-				const Point& v2 = vert[(i + 1) % 3];
-
-				// Utilize the winding order to determine if the point lies outside of an edge.
-				const bool outside = (v1 - projected).cross(v2 - projected).dot(normal) < 0.f;
-				if (outside) {
-					outside_count++;
-					// Clamp the projection value to be in-between of the two ends of the edge.
-					const float t = std::min(std::max((v2 - v1).dot(projected - v1) / v1.distance2(v2), 0.f), 1.f);
-					const Point closest_point_on_edge = v1 * (1.f - t) + v2 * t;
-					const double distance_to_edge = query_point.distance2(closest_point_on_edge);
-					if (distance_to_edge < shortest_distance) {
-						closest_point = closest_point_on_edge;
-						shortest_distance = distance_to_edge;
-					}
+		return visit_packets([&](const auto& packets) { return this->closest_point(packets, query_point, max_dist, closest_point); });
+	}
+
+	bool ClosestPointQuery::operator() (const Point& query_point, float max_dist, QueryResult& result) const {
+		return visit_packets([&](const auto& packets) { return this->closest_point(packets, query_point, max_dist, result); });
+	}
+
+	bool ClosestPointQuery::signed_distance(const Point& query_point, float max_dist, float& signed_distance, QueryResult& result) const {
+		if (!(*this)(query_point, max_dist, result)) return false;
+		const float distance = sqrtf(result.distance2);
+		signed_distance = (query_point - result.closest_point).dot(pseudo_normal(result)) < 0.f ? -distance : distance;
+		return true;
+	}
+
+	Vec3 ClosestPointQuery::pseudo_normal(const QueryResult& result) const {
+		assert(!pseudo_normals.empty() && "Pseudo-normals are only computed with BuildOptions::pseudo_normals.");
+		const PackedVec3* normals = &pseudo_normals[result.triangle * 7];
+		// An edge is the one opposite to the vertex with a zero barycentric coordinate, a vertex is the one with a coordinate of one.
+		for (size_t k = 0; k < 3; ++k) {
+			if (result.feature == TriangleFeature::Edge && result.barycentric[k] == 0.f) return normals[1 + (k + 1) % 3];
+			if (result.feature == TriangleFeature::Vertex && result.barycentric[k] == 1.f) return normals[4 + k];
+		}
+		return normals[0];
+	}
+
+	size_t ClosestPointQuery::memory_usage() const {
+		const size_t mesh_bytes = owned_mesh ? owned_mesh->vertices.capacity() * sizeof(Point) + owned_mesh->indices.capacity() * sizeof(int) : 0;
+		return visit_packets([](const auto& packets) { return packets.memory_usage(); }) + mesh_bytes
+			+ ordered_triangles.size() * sizeof(uint32_t) + pseudo_normals.size() * sizeof(PackedVec3) + r_star_tree.memory_usage();
+	}
+
+	void ClosestPointQuery::bake_grid(const BoundingBox& bound, size_t resolution_x, size_t resolution_y, size_t resolution_z, Span<float> distances, const GridOptions& options) const {
+		assert(distances.size() == resolution_x * resolution_y * resolution_z && "Expect one distance per cell of the grid.");
+		assert((!options.signed_distance || !pseudo_normals.empty()) && "Signed distances require BuildOptions::pseudo_normals.");
+		const size_t resolution[3] = { resolution_x, resolution_y, resolution_z };
+		assert((!options.signed_distance || options.max_dist >= FLT_MAX || ((bound.max - bound.min).x() < options.max_dist * resolution_x
+			&& (bound.max - bound.min).y() < options.max_dist * resolution_y && (bound.max - bound.min).z() < options.max_dist * resolution_z))
+			&& "The cells of a signed grid must be smaller than the band, see GridOptions::max_dist.");
+		visit_packets([&](const auto& packets) { bake_grid(packets, bound, resolution, distances, options); });
+	}
+
+	std::vector<std::pair<uint32_t, uint32_t>> sort_query_points(Span<const Point> query_points, QueryOrder order, ThreadPool& thread_pool) {
+		const size_t count = query_points.size();
+		std::vector<std::pair<uint32_t, uint32_t>> sorted;
+		if (order == QueryOrder::Input || count <= QUERY_CHUNK_SIZE) return sorted;
+		const size_t chunk_count = (count + CONSTRUCTION_CHUNK_SIZE - 1) / CONSTRUCTION_CHUNK_SIZE;
+		std::vector<BoundingBox> chunk_bounds(chunk_count);
+		thread_pool.parallel_for(chunk_count, [&](size_t chunk) {
+			const size_t end = std::min((chunk + 1) * CONSTRUCTION_CHUNK_SIZE, count);
+			for (size_t i = chunk * CONSTRUCTION_CHUNK_SIZE; i < end; ++i) chunk_bounds[chunk].enlarge(BoundingBox{ query_points[i], query_points[i] });
+		});
+		BoundingBox bound;
+		for (const BoundingBox& b : chunk_bounds) bound.enlarge(b);
+		sorted.resize(count);
+		thread_pool.parallel_for(chunk_count, [&](size_t chunk) {
+			const size_t end = std::min((chunk + 1) * CONSTRUCTION_CHUNK_SIZE, count);
+			for (size_t i = chunk * CONSTRUCTION_CHUNK_SIZE; i < end; ++i) {
+				const uint32_t code = order == QueryOrder::Hilbert ? hilbert_code(query_points[i], bound) : morton_code(query_points[i], bound);
+				sorted[i] = { code, static_cast<uint32_t>(i) };
+			}
+		});
+		std::sort(sorted.begin(), sorted.end());
+		return sorted;
+	}
+
+	void ClosestPointQuery::query_batch(Span<const Point> query_points, Span<const float> max_dists, Span<uint8_t> found, Span<Point> closest_points, const QueryOptions& options) const {
+		assert((max_dists.size() == 1 || max_dists.size() == query_points.size()) && "Expect one maximum distance, or one per query point.");
+		assert(found.size() == query_points.size() && closest_points.size() == query_points.size() && "Expect one result per query point.");
+		ThreadPool& thread_pool = options.thread_pool != nullptr ? *options.thread_pool : ThreadPool::global();
+		const size_t count = query_points.size();
+
+		// Sort the query points along the curve, the results are scattered straight back to the index of each point.
+		const std::vector<std::pair<uint32_t, uint32_t>> order = sort_query_points(query_points, options.order, thread_pool);
+		const auto index = [&](size_t i) -> size_t { return order.empty() ? i : order[i].second; };
+		const auto max_dist = [&](size_t i) { return max_dists.size() == 1 ? max_dists[0] : max_dists[i]; };
+
+		thread_pool.parallel_for_chunked(count, QUERY_CHUNK_SIZE, [&](size_t begin, size_t end) {
+			if (options.traversal == QueryTraversal::Single) {
+				for (size_t i = begin; i < end; ++i) found[index(i)] = (*this)(query_points[index(i)], max_dist(index(i)), closest_points[index(i)]);
+				return;
+			}
+			// Gather consecutive query points into packets, the last one of the chunk may be partially filled.
+			for (size_t first = begin; first < end; first += FloatPacket::WIDTH) {
+				const size_t lane_count = std::min(FloatPacket::WIDTH, end - first);
+				Point points[FloatPacket::WIDTH], closest[FloatPacket::WIDTH];
+				float dists[FloatPacket::WIDTH];
+				bool found_lanes[FloatPacket::WIDTH];
+				for (size_t lane = 0; lane < lane_count; ++lane) {
+					points[lane] = query_points[index(first + lane)];
+					dists[lane] = max_dist(index(first + lane));
+				}
+				this->closest_points(lane_count, points, dists, found_lanes, closest);
+				for (size_t lane = 0; lane < lane_count; ++lane) {
+					found[index(first + lane)] = found_lanes[lane];
+					if (found_lanes[lane]) closest_points[index(first + lane)] = closest[lane];
 				}
+			}
+		});
+	}
 
-				// Early termination. (A point can only be outside of at most 2 edges)
-				if (outside_count > 1) return true;
+	void ClosestPointQuery::closest_points(size_t count, const Point* query_points, const float* max_dists, bool* found, Point* closest_points) const {
+		visit_packets([&](const auto& packets) { this->closest_points(packets, count, query_points, max_dists, found, closest_points); });
+	}
+
+	template<typename PACKET>
+	void ClosestPointQuery::pack_buckets(math::AlignedArray<PACKET>& packets, const Mesh& m, const std::vector<uint32_t>& order, size_t leaf_size, ThreadPool& thread_pool) {
+		// Every bucket is padded to whole packets by repeating its last triangle.
+		const size_t bucket_count = (order.size() + leaf_size - 1) / leaf_size;
+		const size_t buckets_per_chunk = std::max<size_t>(CONSTRUCTION_CHUNK_SIZE / leaf_size, 1);
+		packets_per_bucket = (leaf_size + PACKET::WIDTH - 1) / PACKET::WIDTH;
+		packets = math::AlignedArray<PACKET>(bucket_count * packets_per_bucket);
+		thread_pool.parallel_for((bucket_count + buckets_per_chunk - 1) / buckets_per_chunk, [&](size_t chunk) {
+			const size_t end = std::min((chunk + 1) * buckets_per_chunk, bucket_count);
+			for (size_t bucket = chunk * buckets_per_chunk; bucket < end; ++bucket) {
+				const size_t first = bucket * leaf_size, last = std::min(first + leaf_size, order.size()) - 1;
+				for (size_t lane = 0; lane < packets_per_bucket * PACKET::WIDTH; ++lane) {
+					const size_t i = order[std::min(first + lane, last)];
+					packets[bucket * packets_per_bucket + lane / PACKET::WIDTH].set(lane % PACKET::WIDTH, m.vertices[m.indices[i * 3 + 0]], m.vertices[m.indices[i * 3 + 1]], m.vertices[m.indices[i * 3 + 2]]);
+				}
+			}
+		});
+	}
+
+	template<typename INDEX>
+	void ClosestPointQuery::pack_buckets(IndexedTrianglePackets<FloatPacket, INDEX>& packets, const Mesh& m, const std::vector<uint32_t>& order, size_t leaf_size, ThreadPool& thread_pool) {
+		// The same layout as the packets above, the padding lanes repeat the indices of the last triangle.
+		const size_t bucket_count = (order.size() + leaf_size - 1) / leaf_size;
+		const size_t buckets_per_chunk = std::max<size_t>(CONSTRUCTION_CHUNK_SIZE / leaf_size, 1);
+		packets_per_bucket = (leaf_size + FloatPacket::WIDTH - 1) / FloatPacket::WIDTH;
+		packets = IndexedTrianglePackets<FloatPacket, INDEX>(m.vertices.data(), bucket_count * packets_per_bucket);
+		thread_pool.parallel_for((bucket_count + buckets_per_chunk - 1) / buckets_per_chunk, [&](size_t chunk) {
+			const size_t end = std::min((chunk + 1) * buckets_per_chunk, bucket_count);
+			for (size_t bucket = chunk * buckets_per_chunk; bucket < end; ++bucket) {
+				const size_t first = bucket * leaf_size, last = std::min(first + leaf_size, order.size()) - 1;
+				for (size_t lane = 0; lane < packets_per_bucket * FloatPacket::WIDTH; ++lane) {
+					const size_t i = order[std::min(first + lane, last)];
+					packets.set(bucket * packets_per_bucket + lane / FloatPacket::WIDTH, lane % FloatPacket::WIDTH,
+						static_cast<INDEX>(m.indices[i * 3 + 0]), static_cast<INDEX>(m.indices[i * 3 + 1]), static_cast<INDEX>(m.indices[i * 3 + 2]));
+				}
 			}
+		});
+	}
 
-			// Projection of the query point lies within the triangle.
-			if (outside_count == 0) {
-				closest_point = projected;
-				shortest_distance = distance_to_plane;
+	template<typename PACKETS>
+	bool ClosestPointQuery::closest_point(const PACKETS& packets, const Point& query_point, float max_dist, Point& closest_point) const {
+		// The search starts with the squared maximum distance and shrinks whenever a closer point is found.
+		float shortest_distance = squared_radius(max_dist);
+		bool found = false;
+		const auto search_callback = [&](uint32_t bucket) -> float {
+			const size_t first = bucket * packets_per_bucket;
+			for (size_t i = first; i < first + packets_per_bucket; ++i) {
+				found |= packets[i].closest_point(query_point, shortest_distance, closest_point);
 			}
-			return true; // Keep traversing
+			return shortest_distance; // Shrink the search radius to the shortest distance so far.
 		};
 
-		// Query the R-Tree around the bounding box which we defined eariler.
-		// For each overlapping triangles, find the closest point from the query point to the triangle.
-		// A detailed explanation can be found in README.md.
-		r_star_tree.search_radius(
+		// Query the R-Tree nearest-first within the maximum search distance.
+		// For each candidate bucket, find the closest point from the query point to its triangles, a packet at a time.
+		r_star_tree.search_nearest(
 			query_point,
 			max_dist,
 			search_callback
 		);
 
-		return shortest_distance != DBL_MAX; // Return true if the closest point is found, else false.
+		return found; // Return true if the closest point is found, else false.
+	}
+
+	template<typename PACKETS>
+	bool ClosestPointQuery::closest_point(const PACKETS& packets, const Point& query_point, float max_dist, QueryResult& result) const {
+		float shortest_distance = squared_radius(max_dist);
+		Point closest_point;
+		size_t closest_packet = SIZE_MAX, closest_lane = 0;
+		const auto search_callback = [&](uint32_t bucket) -> float {
+			const size_t first = bucket * packets_per_bucket;
+			for (size_t i = first; i < first + packets_per_bucket; ++i) {
+				if (packets[i].closest_point(query_point, shortest_distance, closest_point, &closest_lane)) closest_packet = i;
+			}
+			return shortest_distance;
+		};
+		r_star_tree.search_nearest(query_point, max_dist, search_callback);
+		if (closest_packet == SIZE_MAX) return false;
+		fill_result(closest_packet, closest_lane, query_point, closest_point, shortest_distance, result);
+		return true;
+	}
+
+	void ClosestPointQuery::fill_result(size_t packet, size_t lane, const Point& query_point, const Point& closest_point, float distance2, QueryResult& result) const {
+		// Map the lane back to the triangle, padding lanes repeat the last triangle of their bucket.
+		const size_t bucket = packet / packets_per_bucket;
+		const size_t position = bucket * leaf_size + (packet % packets_per_bucket) * FloatPacket::WIDTH + lane;
+		const size_t last = std::min((bucket + 1) * leaf_size, ordered_triangles.size()) - 1;
+		result.closest_point = closest_point;
+		result.distance2 = distance2;
+		result.triangle = ordered_triangles[std::min(position, last)];
+		const int* triangle = &mesh->indices[result.triangle * 3];
+		result.feature = closest_feature_on_triangle(query_point, mesh->vertices[triangle[0]], mesh->vertices[triangle[1]], mesh->vertices[triangle[2]], result.barycentric);
+	}
+
+	template<typename PACKETS>
+	void ClosestPointQuery::bake_grid(const PACKETS& packets, const BoundingBox& bound, const size_t (&resolution)[3], Span<float> distances, const GridOptions& options) const {
+		ThreadPool& thread_pool = options.thread_pool != nullptr ? *options.thread_pool : ThreadPool::global();
+		const Vec3 cell_size = (bound.max - bound.min) / Vec3(float(resolution[0]), float(resolution[1]), float(resolution[2]));
+		const auto sample = [&](size_t x, size_t y, size_t z) { return bound.min + cell_size * Vec3(x + 0.5f, y + 0.5f, z + 0.5f); };
+		const size_t tile_counts[3] = {
+			(resolution[0] + GRID_TILE_SIZE - 1) / GRID_TILE_SIZE, (resolution[1] + GRID_TILE_SIZE - 1) / GRID_TILE_SIZE, (resolution[2] + GRID_TILE_SIZE - 1) / GRID_TILE_SIZE
+		};
+		const float max_dist2 = squared_radius(options.max_dist);
+		// The samples outside the band of a signed grid are only given their sign once every tile is baked.
+		std::vector<uint8_t> out_of_band(options.signed_distance && options.max_dist < FLT_MAX ? distances.size() : 0);
+
+		thread_pool.parallel_for_chunked(tile_counts[0] * tile_counts[1] * tile_counts[2], 1, [&](size_t begin, size_t end) {
+			// A bucket within reach of the tile, with its squared distance to the center of the tile.
+			struct Candidate {
+				float distance2;
+				uint32_t bucket;
+				BoundingBox bound;
+				bool operator<(const Candidate& other) const { return distance2 < other.distance2; }
+			};
+			std::vector<Candidate> candidates;
+			for (size_t tile = begin; tile < end; ++tile) {
+				const size_t first[3] = { tile % tile_counts[0] * GRID_TILE_SIZE, tile / tile_counts[0] % tile_counts[1] * GRID_TILE_SIZE, tile / tile_counts[0] / tile_counts[1] * GRID_TILE_SIZE };
+				const size_t last[3] = { std::min(first[0] + GRID_TILE_SIZE, resolution[0]), std::min(first[1] + GRID_TILE_SIZE, resolution[1]), std::min(first[2] + GRID_TILE_SIZE, resolution[2]) };
+				const BoundingBox tile_bound{ sample(first[0], first[1], first[2]), sample(last[0] - 1, last[1] - 1, last[2] - 1) };
+				const Point center = (tile_bound.min + tile_bound.max) * 0.5f;
+				const float radius = (tile_bound.max - center).length();
+
+				// Every sample is within radius of the center, so its closest point is within the distance of the center plus radius.
+				// Gather the buckets within that reach of the tile once, slightly enlarged to stay on the safe side of rounding.
+				Point closest_point;
+				float reach = options.max_dist;
+				if (this->closest_point(packets, center, options.max_dist, closest_point)) reach = std::min(center.distance(closest_point) + radius, options.max_dist);
+				candidates.clear();
+				r_star_tree.search_box(tile_bound, reach * 1.0001f, [&](uint32_t bucket, const BoundingBox& b) {
+					candidates.push_back({ b.distance2(center), bucket, b });
+					return true;
+				});
+				std::sort(candidates.begin(), candidates.end());
+
+				for (size_t z = first[2]; z < last[2]; ++z) {
+					for (size_t y = first[1]; y < last[1]; ++y) {
+						for (size_t x = first[0]; x < last[0]; ++x) {
+							const Point p = sample(x, y, z);
+							float shortest_distance = max_dist2;
+							size_t closest_packet = SIZE_MAX, closest_lane = 0;
+							for (const Candidate& candidate : candidates) {
+								if (candidate.bound.distance2(p) >= shortest_distance) continue;
+								const size_t first_packet = candidate.bucket * packets_per_bucket;
+								for (size_t i = first_packet; i < first_packet + packets_per_bucket; ++i) {
+									if (packets[i].closest_point(p, shortest_distance, closest_point, &closest_lane)) closest_packet = i;
+								}
+							}
+							float& distance = distances[x + resolution[0] * (y + resolution[1] * z)];
+							if (closest_packet == SIZE_MAX) {
+								distance = options.max_dist;
+								if (!out_of_band.empty()) out_of_band[x + resolution[0] * (y + resolution[1] * z)] = true;
+								continue;
+							}
+							distance = sqrtf(shortest_distance);
+							if (options.signed_distance) {
+								QueryResult result;
+								fill_result(closest_packet, closest_lane, p, closest_point, shortest_distance, result);
+								if ((p - closest_point).dot(pseudo_normal(result)) < 0.f) distance = -distance;
+							}
+						}
+					}
+				}
+			}
+		});
+		if (!out_of_band.empty()) flood_band_signs(resolution, out_of_band, distances);
+	}
+
+	template<typename PACKETS>
+	void ClosestPointQuery::closest_points(const PACKETS& packets, size_t count, const Point* query_points, const float* max_dists, bool* found, Point* closest_points) const {
+		assert(count <= FloatPacket::WIDTH && "Too many query points for a packet.");
+		// Each lane starts with its squared maximum distance, unused lanes are disabled with a negative radius.
+		alignas(32) float shortest_distances[FloatPacket::WIDTH];
+		alignas(32) float x[FloatPacket::WIDTH], y[FloatPacket::WIDTH], z[FloatPacket::WIDTH];
+		for (size_t lane = 0; lane < FloatPacket::WIDTH; ++lane) {
+			const Point& p = query_points[std::min(lane, count - 1)];
+			x[lane] = p.x(); y[lane] = p.y(); z[lane] = p.z();
+			shortest_distances[lane] = lane >= count ? -1.f : squared_radius(max_dists[lane]);
+		}
+		for (size_t lane = 0; lane < count; ++lane) found[lane] = false;
+		const auto search_callback = [&](uint32_t bucket, int lane_mask) {
+			const size_t first = bucket * packets_per_bucket;
+			for (; lane_mask != 0; lane_mask &= lane_mask - 1) {
+				const size_t lane = math::count_trailing_zeros(lane_mask);
+				for (size_t i = first; i < first + packets_per_bucket; ++i) {
+					found[lane] |= packets[i].closest_point(query_points[lane], shortest_distances[lane], closest_points[lane]);
+				}
+			}
+		};
+
+		// Query the R-Tree with the whole packet, every node is tested against all lanes at once.
+		// For each candidate bucket, run the triangle kernel of every lane that reaches it.
+		r_star_tree.search_nearest_packet(
+			FloatPacket::load(x), FloatPacket::load(y), FloatPacket::load(z),
+			shortest_distances,
+			search_callback
+		);
 	}
 
 } // namespace geoutils
\ No newline at end of file
@@ -0,0 +1,137 @@
+#include "DistanceField.h"
+
+namespace geoutils {
+
+	// Number of cells claimed at a time by a thread while building a level of the octree, each one runs 19 exact queries.
+	const size_t DISTANCE_FIELD_CHUNK_SIZE = 16;
+
+	// Interpolate trilinearly between 8 corner values ordered by octant, at the relative position t within the cell.
+	static float trilinear(const float* corners, const Vec3& t) {
+		const float x00 = corners[0] + (corners[1] - corners[0]) * t.x(), x10 = corners[2] + (corners[3] - corners[2]) * t.x();
+		const float x01 = corners[4] + (corners[5] - corners[4]) * t.x(), x11 = corners[6] + (corners[7] - corners[6]) * t.x();
+		const float y0 = x00 + (x10 - x00) * t.y(), y1 = x01 + (x11 - x01) * t.y();
+		return y0 + (y1 - y0) * t.z();
+	}
+
+	AdaptiveDistanceField::AdaptiveDistanceField(const ClosestPointQuery& query, const BoundingBox& bound, const DistanceFieldOptions& options)
+		: query{ &query }, root_bound{ bound }, signed_distance{ options.signed_distance } {
+		assert(bound.max.x() > bound.min.x() && bound.max.y() > bound.min.y() && bound.max.z() > bound.min.z() && "Expect a box with a positive size.");
+		ThreadPool& thread_pool = options.thread_pool != nullptr ? *options.thread_pool : ThreadPool::global();
+		// A cell waiting to be evaluated, with the distances at its corners already sampled by its parent.
+		struct PendingCell {
+			uint32_t cell;
+			size_t depth;
+			BoundingBox bound;
+			float corners[8];
+		};
+		// The 3x3x3 lattice of samples of a cell, the corners and the centers of its edges, faces and of the cell itself.
+		struct Lattice {
+			float samples[27];
+			CellType type;
+		};
+		const auto lattice_point = [](const BoundingBox& b, size_t i, size_t j, size_t k) {
+			return b.min + (b.max - b.min) * Vec3(i * 0.5f, j * 0.5f, k * 0.5f);
+		};
+
+		cells.push_back(Cell());
+		std::vector<PendingCell> level(1), next_level;
+		level[0].cell = 0;
+		level[0].depth = 0;
+		level[0].bound = bound;
+		for (size_t corner = 0; corner < 8; ++corner) level[0].corners[corner] = exact_distance(lattice_point(bound, corner & 1 ? 2 : 0, corner & 2 ? 2 : 0, corner & 4 ? 2 : 0));
+
+		// Evaluate the octree a level at a time, the cells of a level are independent.
+		std::vector<Lattice> lattices;
+		while (!level.empty()) {
+			lattices.resize(level.size());
+			thread_pool.parallel_for_chunked(level.size(), DISTANCE_FIELD_CHUNK_SIZE, [&](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; ++i) {
+					const PendingCell& pending = level[i];
+					Lattice& lattice = lattices[i];
+					float max_error = 0.f, min_distance = FLT_MAX;
+					for (size_t n = 0; n < 27; ++n) {
+						const size_t x = n % 3, y = n / 3 % 3, z = n / 9;
+						if (x != 1 && y != 1 && z != 1) {
+							lattice.samples[n] = pending.corners[(x / 2) | (y / 2) << 1 | (z / 2) << 2];
+						}
+						else {
+							lattice.samples[n] = exact_distance(lattice_point(pending.bound, x, y, z));
+							max_error = std::max(max_error, fabsf(trilinear(pending.corners, Vec3(x * 0.5f, y * 0.5f, z * 0.5f)) - lattice.samples[n]));
+						}
+						min_distance = std::min(min_distance, fabsf(lattice.samples[n]));
+					}
+					// Every point of the cell is within half its diagonal of a sample, so the surface is at least that much closer than any sample.
+					const bool near_surface = min_distance - (pending.bound.max - pending.bound.min).length() * 0.5f <= options.band;
+					if (max_error <= options.tolerance * 0.5f) lattice.type = CellType::Leaf;
+					else if (pending.depth < options.max_depth && near_surface) lattice.type = CellType::Internal;
+					else lattice.type = CellType::Fallback;
+				}
+			});
+
+			// Append the children of the subdivided cells, their corners are samples of the parent's lattice.
+			next_level.clear();
+			for (size_t i = 0; i < level.size(); ++i) {
+				const PendingCell& pending = level[i];
+				const Lattice& lattice = lattices[i];
+				Cell& cell = cells[pending.cell];
+				cell.type = lattice.type;
+				if (lattice.type == CellType::Leaf) {
+					cell.index = static_cast<uint32_t>(corner_distances.size());
+					corner_distances.insert(corner_distances.end(), pending.corners, pending.corners + 8);
+				}
+				if (lattice.type != CellType::Internal) continue;
+				assert(cells.size() + 8 < UINT32_MAX && "Too many cells for 32-bit indices.");
+				cell.index = static_cast<uint32_t>(cells.size());
+				cells.resize(cells.size() + 8);
+				const Point center = (pending.bound.min + pending.bound.max) * 0.5f;
+				for (size_t octant = 0; octant < 8; ++octant) {
+					PendingCell child;
+					child.cell = static_cast<uint32_t>(cells[pending.cell].index + octant);
+					child.depth = pending.depth + 1;
+					const Point& min = pending.bound.min;
+					const Point& max = pending.bound.max;
+					child.bound.min = Point(octant & 1 ? center.x() : min.x(), octant & 2 ? center.y() : min.y(), octant & 4 ? center.z() : min.z());
+					child.bound.max = Point(octant & 1 ? max.x() : center.x(), octant & 2 ? max.y() : center.y(), octant & 4 ? max.z() : center.z());
+					for (size_t corner = 0; corner < 8; ++corner) {
+						const size_t x = (octant & 1) + (corner & 1), y = (octant >> 1 & 1) + (corner >> 1 & 1), z = (octant >> 2) + (corner >> 2);
+						child.corners[corner] = lattice.samples[x + 3 * y + 9 * z];
+					}
+					next_level.push_back(child);
+				}
+			}
+			level.swap(next_level);
+		}
+		cells.shrink_to_fit();
+		corner_distances.shrink_to_fit();
+	}
+
+	bool AdaptiveDistanceField::interpolate(const Point& point, float& distance) const {
+		if (!(root_bound.distance2(point) == 0.f)) return false;
+		// Descend to the leaf containing the point, halving the bounds of the cell along the way.
+		Point min = root_bound.min, max = root_bound.max;
+		const Cell* cell = &cells[0];
+		while (cell->type == CellType::Internal) {
+			const Point center = (min + max) * 0.5f;
+			const bool upper[3] = { point.x() >= center.x(), point.y() >= center.y(), point.z() >= center.z() };
+			min = Point(upper[0] ? center.x() : min.x(), upper[1] ? center.y() : min.y(), upper[2] ? center.z() : min.z());
+			max = Point(upper[0] ? max.x() : center.x(), upper[1] ? max.y() : center.y(), upper[2] ? max.z() : center.z());
+			cell = &cells[cell->index + (upper[0] | upper[1] << 1 | upper[2] << 2)];
+		}
+		if (cell->type == CellType::Fallback) return false;
+		distance = trilinear(&corner_distances[cell->index], (point - min) / (max - min));
+		return true;
+	}
+
+	float AdaptiveDistanceField::exact_distance(const Point& point) const {
+		float distance = FLT_MAX;
+		if (signed_distance) {
+			query->signed_distance(point, FLT_MAX, distance);
+		}
+		else {
+			Point closest_point;
+			if ((*query)(point, FLT_MAX, closest_point)) distance = point.distance(closest_point);
+		}
+		return distance;
+	}
+
+} // namespace geoutils
@@ -0,0 +1,88 @@
+#include "SceneClosestPointQuery.h"
+
+namespace geoutils {
+
+	// Number of query points claimed at a time by a thread of query_batch, a query may visit several meshes.
+	const size_t SCENE_QUERY_CHUNK_SIZE = 128;
+
+	// Place every mesh once where it is.
+	static std::vector<MeshInstance> identity_instances(size_t mesh_count) {
+		std::vector<MeshInstance> instances(mesh_count);
+		for (size_t i = 0; i < mesh_count; ++i) instances[i].mesh = static_cast<uint32_t>(i);
+		return instances;
+	}
+
+	SceneClosestPointQuery::SceneClosestPointQuery(const std::vector<Mesh>& meshes, const BuildOptions& options)
+		: SceneClosestPointQuery(meshes, identity_instances(meshes.size()), options) {}
+
+	SceneClosestPointQuery::SceneClosestPointQuery(const std::vector<Mesh>& meshes, const std::vector<MeshInstance>& instances, const BuildOptions& options)
+		: instances{ instances } {
+		ThreadPool& thread_pool = options.thread_pool != nullptr ? *options.thread_pool : ThreadPool::global();
+		assert(meshes.size() < UINT32_MAX && instances.size() < UINT32_MAX && "Too many meshes or instances for 32-bit indices.");
+		queries.resize(meshes.size());
+		if (meshes.size() >= thread_pool.thread_count()) {
+			// Enough meshes to keep every thread busy, build each one serially on its own thread.
+			thread_pool.parallel_for(meshes.size(), [&](size_t i) {
+				ThreadPool serial_pool(1);
+				BuildOptions mesh_options = options;
+				mesh_options.thread_pool = &serial_pool;
+				queries[i].reset(new ClosestPointQuery(meshes[i], mesh_options));
+			});
+		}
+		else {
+			// A few large meshes, build them one after the other with the whole pool.
+			BuildOptions mesh_options = options;
+			mesh_options.thread_pool = &thread_pool;
+			for (size_t i = 0; i < meshes.size(); ++i) queries[i].reset(new ClosestPointQuery(meshes[i], mesh_options));
+		}
+
+		// Construct the top-level tree over the bounding boxes of the instances, transformed into the scene.
+		std::vector<std::pair<BoundingBox, uint32_t>> entries;
+		entries.reserve(instances.size());
+		for (size_t i = 0; i < instances.size(); ++i) {
+			const MeshInstance& instance = instances[i];
+			assert(instance.mesh < meshes.size() && "Expect instances of the given meshes.");
+			if (meshes[instance.mesh].indices.size() >= 3) entries.push_back({ instance.transform.apply(queries[instance.mesh]->bound()), static_cast<uint32_t>(i) });
+		}
+		RStarTree<uint32_t, 8> tree;
+		tree.bulk_load(entries, &thread_pool);
+		instance_tree = FrozenRStarTree<uint32_t, 8>(tree);
+	}
+
+	bool SceneClosestPointQuery::operator()(const Point& query_point, float max_dist, SceneQueryResult& result) const {
+		// Each instance is only searched within the best distance so far, the tree visits the closest bounding boxes first.
+		// Rigid transforms preserve distances, the query point is searched in the space of the mesh as is.
+		SceneQueryResult best;
+		const auto callback = [&](uint32_t instance) -> float {
+			const MeshInstance& placement = instances[instance];
+			QueryResult candidate;
+			const float instance_max_dist = best.instance == UINT32_MAX ? max_dist : sqrtf(best.distance2);
+			if ((*queries[placement.mesh])(placement.transform.apply_inverse(query_point), instance_max_dist, candidate) && candidate.distance2 < best.distance2) {
+				static_cast<QueryResult&>(best) = candidate;
+				best.mesh = placement.mesh;
+				best.instance = instance;
+			}
+			return best.distance2;
+		};
+		instance_tree.search_nearest(query_point, max_dist, callback);
+		if (best.instance == UINT32_MAX) return false;
+		// Only the closest point is mapped back into the scene.
+		best.closest_point = instances[best.instance].transform.apply(best.closest_point);
+		result = best;
+		return true;
+	}
+
+	void SceneClosestPointQuery::query_batch(Span<const Point> query_points, Span<const float> max_dists, Span<uint8_t> found, Span<SceneQueryResult> results, const QueryOptions& options) const {
+		assert((max_dists.size() == 1 || max_dists.size() == query_points.size()) && "Expect one maximum distance, or one per query point.");
+		assert(found.size() == query_points.size() && results.size() == query_points.size() && "Expect one result per query point.");
+		ThreadPool& thread_pool = options.thread_pool != nullptr ? *options.thread_pool : ThreadPool::global();
+
+		const std::vector<std::pair<uint32_t, uint32_t>> order = sort_query_points(query_points, options.order, thread_pool);
+		const auto index = [&](size_t i) -> size_t { return order.empty() ? i : order[i].second; };
+		const auto max_dist = [&](size_t i) { return max_dists.size() == 1 ? max_dists[0] : max_dists[i]; };
+		thread_pool.parallel_for_chunked(query_points.size(), SCENE_QUERY_CHUNK_SIZE, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) found[index(i)] = (*this)(query_points[index(i)], max_dist(index(i)), results[index(i)]);
+		});
+	}
+
+} // namespace geoutils
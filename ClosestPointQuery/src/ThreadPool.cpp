@@ -0,0 +1,41 @@
+#include "ThreadPool.h"
+
+namespace geoutils {
+
+	ThreadPool::ThreadPool(size_t thread_count) {
+		if (thread_count == 0) thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+		workers.reserve(thread_count - 1);
+		for (size_t i = 1; i < thread_count; ++i) {
+			workers.emplace_back(&ThreadPool::worker_loop, this);
+		}
+	}
+
+	ThreadPool::~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		condition.notify_all();
+		for (std::thread& worker : workers) worker.join();
+	}
+
+	ThreadPool& ThreadPool::global() {
+		static ThreadPool pool;
+		return pool;
+	}
+
+	void ThreadPool::worker_loop() {
+		while (true) {
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+				if (stopping && tasks.empty()) return;
+				task = std::move(tasks.front());
+				tasks.pop();
+			}
+			task();
+		}
+	}
+
+} // namespace geoutils
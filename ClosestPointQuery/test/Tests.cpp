@@ -1,10 +1,47 @@
 #include <gtest/gtest.h>
 #include <ClosestPointQuery.h>
+#include <DistanceField.h>
+#include <SceneClosestPointQuery.h>
 using namespace geoutils;
 
 // Constants declaration
 const Mesh TRIANGLE_MESH = { {Point(1.0, 0.0, 0.0), Point(0.0, 1.0, 0.0), Point(-1.0, 0.0, 0.0)} /*vertices*/, {0, 1, 2} /*indices*/ };
 
+// Compare two vectors component-wise within 4 ULPs, for results that depend on how the backend rounds.
+#define EXPECT_VEC3_FLOAT_EQ(a, b) do { const math::Vec3 _a = (a), _b = (b); EXPECT_FLOAT_EQ(_a.x(), _b.x()); EXPECT_FLOAT_EQ(_a.y(), _b.y()); EXPECT_FLOAT_EQ(_a.z(), _b.z()); } while (0)
+
+// Generate a wavy grid mesh in the XY plane with 2 * resolution^2 triangles, spanning [-1, 1] on both axes.
+Mesh wavy_grid_mesh(int resolution) {
+	Mesh mesh;
+	for (int y = 0; y <= resolution; ++y) {
+		for (int x = 0; x <= resolution; ++x) {
+			const float u = 2.f * x / resolution - 1.f, v = 2.f * y / resolution - 1.f;
+			mesh.vertices.push_back(Point(u, v, 0.2f * sinf(4.f * u) * cosf(3.f * v)));
+		}
+	}
+	for (int y = 0; y < resolution; ++y) {
+		for (int x = 0; x < resolution; ++x) {
+			const int i = y * (resolution + 1) + x;
+			mesh.indices.insert(mesh.indices.end(), { i, i + 1, i + resolution + 1, i + 1, i + resolution + 2, i + resolution + 1 });
+		}
+	}
+	return mesh;
+}
+// A closed cube spanning [-1, 1] on every axis, with counter-clockwise triangles facing outward.
+const Mesh CUBE_MESH = {
+	{ Point(-1, -1, -1), Point(1, -1, -1), Point(-1, 1, -1), Point(1, 1, -1), Point(-1, -1, 1), Point(1, -1, 1), Point(-1, 1, 1), Point(1, 1, 1) } /*vertices*/,
+	{ 0, 2, 3, 0, 3, 1, 4, 5, 7, 4, 7, 6, 0, 1, 5, 0, 5, 4, 2, 6, 7, 2, 7, 3, 0, 4, 6, 0, 6, 2, 1, 3, 7, 1, 7, 5 } /*indices*/
+};
+
+// Generate deterministic pseudo-random query points within [-extent, extent]^3.
+std::vector<Point> random_points(size_t count, float extent) {
+	std::vector<Point> points(count);
+	uint32_t state = 12345u;
+	const auto next = [&]() { state = state * 1664525u + 1013904223u; return (state >> 8) / float(1 << 24) * 2.f - 1.f; };
+	for (size_t i = 0; i < count; ++i) points[i] = Point(next(), next(), next()) * extent;
+	return points;
+}
+
 TEST(Math_Vec3, Construct) {
 	math::Vec3 a;
 	EXPECT_FLOAT_EQ(a.x(), 0.f);
@@ -41,8 +78,8 @@ TEST(Math_Vec3, LinearAlgebra) {
 	EXPECT_EQ(a.cross(math::Vec3(3.f, 2.f, 1.f)), math::Vec3(-4.f, 8.f, -4.f));
 	EXPECT_EQ(b.cross(c), math::Vec3(14.f, 20.f, -18.f));
 	EXPECT_EQ(a.normalize(), b.normalize());
-	EXPECT_EQ(a.normalize(), math::Vec3(0.2672612419124244f, 0.5345224838248488f, 0.8017837257372732f));
-	EXPECT_EQ(c.normalize(), math::Vec3(0.5746957711326908f, 0.2873478855663454f, 0.7662610281769211f));
+	EXPECT_VEC3_FLOAT_EQ(a.normalize(), math::Vec3(0.2672612419124244f, 0.5345224838248488f, 0.8017837257372732f));
+	EXPECT_VEC3_FLOAT_EQ(c.normalize(), math::Vec3(0.5746957711326908f, 0.2873478855663454f, 0.7662610281769211f));
 }
 TEST(Math_Vec3, Miscellaneous) {
 	math::Vec3 a(1.f, 8.f, 3.f);
@@ -53,6 +90,15 @@ TEST(Math_Vec3, Miscellaneous) {
 	EXPECT_EQ(a.max(b), math::Vec3(2.f, 8.f, 6.f));
 	EXPECT_TRUE(math::Vec3(0.0000001f, 0.f, 0.f).nearly_zero());
 }
+TEST(Math_Vec3, Packed) {
+	// Consecutive packed vectors are loaded without reading the neighbouring ones.
+	const std::vector<math::PackedVec3> packed = { math::PackedVec3(1.f, 2.f, 3.f), math::Vec3(-4.f, 5.f, -6.f) };
+	EXPECT_EQ(sizeof(math::PackedVec3) * packed.size(), 24u);
+	EXPECT_EQ(math::Vec3(packed[0]), math::Vec3(1.f, 2.f, 3.f));
+	EXPECT_EQ(math::Vec3(packed[1]), math::Vec3(-4.f, 5.f, -6.f));
+	EXPECT_EQ(math::Vec3(packed[1]).dot(math::Vec3(1.f)), -5.f);
+	EXPECT_EQ(packed[1], math::PackedVec3(-4.f, 5.f, -6.f));
+}
 
 
 // Given a point lies inside the triangle, the closest point should be the point itself.
@@ -86,6 +132,13 @@ TEST(ClosestPointQuery_CoplanarCases, NotFound) {
 	bool found = query(Point(2.0, 0.0, 0.0), 0.5, closest_point);
 	EXPECT_FALSE(found);
 }
+// Given a negative query distance, no closest point should be found, even on the triangle itself.
+TEST(ClosestPointQuery_CoplanarCases, NegativeDistance) {
+	ClosestPointQuery query(TRIANGLE_MESH);
+	Point closest_point;
+	EXPECT_FALSE(query(Point(0.2f, 0.2f, 0.f), -1.f, closest_point));
+	EXPECT_FALSE(query(Point(0.2f, 0.2f, 0.f), -FLT_MAX, closest_point));
+}
 
 // Given a point directly above the triangle, the closest point should be the projection onto the triangle.
 TEST(ClosestPointQuery_ProjectionCases, ProjectOnFace) {
@@ -119,6 +172,952 @@ TEST(ClosestPointQuery_ProjectionCases, NotFound) {
 	EXPECT_FALSE(found);
 }
 
+// Given points closest to the face, an edge and a vertex, the result should report the feature and its barycentric coordinates.
+TEST(ClosestPointQuery_Result, Features) {
+	ClosestPointQuery query(TRIANGLE_MESH);
+	QueryResult result;
+	ASSERT_TRUE(query(Point(0.0, 0.5, 1.0), FLT_MAX, result));
+	EXPECT_EQ(result.feature, TriangleFeature::Face);
+	EXPECT_EQ(result.triangle, 0u);
+	EXPECT_FLOAT_EQ(result.distance2, 1.f);
+	EXPECT_VEC3_FLOAT_EQ(result.barycentric, Vec3(0.25f, 0.5f, 0.25f));
+	ASSERT_TRUE(query(Point(0.0, -1.0, 1.0), FLT_MAX, result));
+	EXPECT_EQ(result.feature, TriangleFeature::Edge);
+	EXPECT_FLOAT_EQ(result.distance2, 2.f);
+	EXPECT_VEC3_FLOAT_EQ(result.barycentric, Vec3(0.5f, 0.f, 0.5f));
+	ASSERT_TRUE(query(Point(1.0, -1.0, 1.0), FLT_MAX, result));
+	EXPECT_EQ(result.feature, TriangleFeature::Vertex);
+	EXPECT_EQ(result.barycentric, Vec3(1.f, 0.f, 0.f));
+	EXPECT_FALSE(query(Point(1.0, -1.0, 1.0), 0.5, result));
+}
+// Given the same mesh with every kernel, the result should match the closest point query and describe the triangle it lies on.
+TEST(ClosestPointQuery_Result, MatchesClosestPoint) {
+	const Mesh mesh = wavy_grid_mesh(24);
+	const TriangleKernel kernels[] = { TriangleKernel::Vertices, TriangleKernel::Precomputed, TriangleKernel::Jones, TriangleKernel::Indexed };
+	for (TriangleKernel kernel : kernels) {
+		BuildOptions options;
+		options.kernel = kernel;
+		options.leaf_size = 6; // Leave padding lanes in the buckets.
+		ClosestPointQuery query(mesh, options);
+		for (const Point& p : random_points(200, 1.5f)) {
+			Point closest_point;
+			QueryResult result;
+			ASSERT_EQ(query(p, 0.5f, closest_point), query(p, 0.5f, result));
+			if (result.triangle == UINT32_MAX) continue;
+			EXPECT_EQ(result.closest_point, closest_point);
+			EXPECT_NEAR(result.distance2, p.distance2(closest_point), 1e-5f);
+			// The triangle should be at the same distance, and its vertices interpolated with the barycentric coordinates should give the closest point.
+			const Point vertices[3] = { mesh.vertices[mesh.indices[result.triangle * 3]], mesh.vertices[mesh.indices[result.triangle * 3 + 1]], mesh.vertices[mesh.indices[result.triangle * 3 + 2]] };
+			float triangle_distance = FLT_MAX;
+			Point triangle_point;
+			closest_point_on_triangle(p, vertices, triangle_distance, triangle_point);
+			EXPECT_NEAR(triangle_distance, result.distance2, 1e-5f);
+			const Point interpolated = vertices[0] * result.barycentric.x() + vertices[1] * result.barycentric.y() + vertices[2] * result.barycentric.z();
+			EXPECT_LT(interpolated.distance(closest_point), 1e-4f);
+			EXPECT_NEAR(result.barycentric.x() + result.barycentric.y() + result.barycentric.z(), 1.f, 1e-5f);
+		}
+	}
+}
+
+// Given points around and inside a closed cube, the signed distance should match the analytic one, including near its edges and corners.
+TEST(ClosestPointQuery_SignedDistance, Cube) {
+	const TriangleKernel kernels[] = { TriangleKernel::Vertices, TriangleKernel::Jones };
+	for (TriangleKernel kernel : kernels) {
+		BuildOptions options;
+		options.kernel = kernel;
+		options.pseudo_normals = true;
+		ClosestPointQuery query(CUBE_MESH, options);
+		for (const Point& p : random_points(1000, 2.f)) {
+			const Vec3 q = Vec3(fabsf(p.x()), fabsf(p.y()), fabsf(p.z())) - Vec3(1.f);
+			const float expected = q.max(Vec3(0.f)).length() + std::min(std::max(q.x(), std::max(q.y(), q.z())), 0.f);
+			float signed_distance = 0.f;
+			ASSERT_TRUE(query.signed_distance(p, FLT_MAX, signed_distance));
+			EXPECT_NEAR(signed_distance, expected, 1e-5f);
+		}
+	}
+}
+// Given points closest to a face, an edge and a corner of a cube, the pseudo-normal should point away from the matching feature.
+TEST(ClosestPointQuery_SignedDistance, PseudoNormals) {
+	BuildOptions options;
+	options.pseudo_normals = true;
+	ClosestPointQuery query(CUBE_MESH, options);
+	QueryResult result;
+	float signed_distance = 0.f;
+	ASSERT_TRUE(query.signed_distance(Point(0.2f, 0.3f, 2.f), FLT_MAX, signed_distance, result));
+	EXPECT_VEC3_FLOAT_EQ(query.pseudo_normal(result), Vec3(0.f, 0.f, 1.f));
+	ASSERT_TRUE(query.signed_distance(Point(2.f, 0.3f, 2.f), FLT_MAX, signed_distance, result));
+	EXPECT_EQ(result.feature, TriangleFeature::Edge);
+	EXPECT_VEC3_FLOAT_EQ(query.pseudo_normal(result), Vec3(1.f, 0.f, 1.f).normalize());
+	ASSERT_TRUE(query.signed_distance(Point(-2.f, -2.f, -2.f), FLT_MAX, signed_distance, result));
+	EXPECT_EQ(result.feature, TriangleFeature::Vertex);
+	EXPECT_VEC3_FLOAT_EQ(query.pseudo_normal(result), Vec3(-1.f).normalize());
+	EXPECT_FLOAT_EQ(signed_distance, sqrtf(3.f));
+	EXPECT_GT(query.memory_usage(), ClosestPointQuery(CUBE_MESH).memory_usage());
+}
+
+// Given a grid with partially filled tiles, every baked sample should match querying its point one at a time, within and beyond a narrow band.
+TEST(ClosestPointQuery_BakeGrid, MatchesSingle) {
+	const Mesh mesh = wavy_grid_mesh(24);
+	ClosestPointQuery query(mesh);
+	const BoundingBox bound{ Point(-1.5f), Point(1.5f) };
+	const size_t resolution[3] = { 13, 9, 7 };
+	ThreadPool thread_pool(4);
+	const float max_dists[] = { FLT_MAX, 0.2f };
+	for (float max_dist : max_dists) {
+		GridOptions options;
+		options.thread_pool = &thread_pool;
+		options.max_dist = max_dist;
+		std::vector<float> distances(resolution[0] * resolution[1] * resolution[2], -1.f);
+		query.bake_grid(bound, resolution[0], resolution[1], resolution[2], distances, options);
+		for (size_t z = 0; z < resolution[2]; ++z) for (size_t y = 0; y < resolution[1]; ++y) for (size_t x = 0; x < resolution[0]; ++x) {
+			const Point p = bound.min + (bound.max - bound.min) * Vec3((x + 0.5f) / resolution[0], (y + 0.5f) / resolution[1], (z + 0.5f) / resolution[2]);
+			Point closest_point;
+			const float expected = query(p, max_dist, closest_point) ? p.distance(closest_point) : max_dist;
+			EXPECT_NEAR(distances[x + resolution[0] * (y + resolution[1] * z)], expected, 1e-5f);
+		}
+	}
+}
+// Given a closed cube, the baked signed distances should match the signed distance queries, negative inside.
+TEST(ClosestPointQuery_BakeGrid, SignedDistance) {
+	BuildOptions build_options;
+	build_options.pseudo_normals = true;
+	ClosestPointQuery query(CUBE_MESH, build_options);
+	const BoundingBox bound{ Point(-2.f), Point(2.f) };
+	GridOptions options;
+	options.signed_distance = true;
+	std::vector<float> distances(10 * 10 * 10);
+	query.bake_grid(bound, 10, 10, 10, distances, options);
+	for (size_t i = 0; i < distances.size(); ++i) {
+		const Point p = bound.min + Vec3(i % 10 + 0.5f, i / 10 % 10 + 0.5f, i / 100 + 0.5f) * 0.4f;
+		float expected = 0.f;
+		ASSERT_TRUE(query.signed_distance(p, FLT_MAX, expected));
+		EXPECT_NEAR(distances[i], expected, 1e-5f);
+	}
+	EXPECT_LT(distances[5 + 10 * (5 + 10 * 5)], 0.f);
+}
+// Given a closed cube and a band thinner than its half-width, the samples beyond the band should keep the sign of their side of the surface.
+TEST(ClosestPointQuery_BakeGrid, SignedDistanceNarrowBand) {
+	BuildOptions build_options;
+	build_options.pseudo_normals = true;
+	ClosestPointQuery query(CUBE_MESH, build_options);
+	const BoundingBox bound{ Point(-2.f), Point(2.f) };
+	GridOptions options;
+	options.signed_distance = true;
+	options.max_dist = 0.5f;
+	std::vector<float> distances(16 * 16 * 16);
+	query.bake_grid(bound, 16, 16, 16, distances, options);
+	for (size_t i = 0; i < distances.size(); ++i) {
+		const Point p = bound.min + Vec3(i % 16 + 0.5f, i / 16 % 16 + 0.5f, i / 256 + 0.5f) * 0.25f;
+		float expected = 0.f;
+		ASSERT_TRUE(query.signed_distance(p, FLT_MAX, expected));
+		EXPECT_NEAR(distances[i], fabsf(expected) < options.max_dist ? expected : copysignf(options.max_dist, expected), 1e-5f);
+	}
+	EXPECT_EQ(distances[8 + 16 * (8 + 16 * 8)], -options.max_dist);
+	EXPECT_EQ(distances[0], options.max_dist);
+}
+
+// Given a closed cube, the distance field should interpolate near the surface within the tolerance and fall back to exact queries elsewhere.
+TEST(AdaptiveDistanceField_Query, SignedWithinTolerance) {
+	BuildOptions build_options;
+	build_options.pseudo_normals = true;
+	ClosestPointQuery query(CUBE_MESH, build_options);
+	DistanceFieldOptions options;
+	options.signed_distance = true;
+	options.max_depth = 5;
+	options.band = 0.25f;
+	const AdaptiveDistanceField field(query, BoundingBox{ Point(-1.7f), Point(1.9f) }, options);
+	size_t interpolated_count = 0;
+	for (const Point& p : random_points(2000, 2.f)) {
+		float expected = 0.f, distance = 0.f;
+		ASSERT_TRUE(query.signed_distance(p, FLT_MAX, expected));
+		EXPECT_NEAR(field(p), expected, options.tolerance);
+		if (!field.interpolate(p, distance)) continue;
+		++interpolated_count;
+		EXPECT_NEAR(distance, expected, options.tolerance);
+	}
+	EXPECT_GT(interpolated_count, 500u);
+	float distance = 0.f;
+	EXPECT_FALSE(field.interpolate(Point(1.95f, 0.f, 0.f), distance));
+	EXPECT_FLOAT_EQ(field(Point(1.95f, 0.f, 0.f)), 0.95f);
+}
+// Given a looser tolerance, the field should need fewer cells. Building in parallel should give the same octree.
+TEST(AdaptiveDistanceField_Query, Tolerance) {
+	BuildOptions build_options;
+	build_options.pseudo_normals = true;
+	ClosestPointQuery query(CUBE_MESH, build_options);
+	ThreadPool serial_pool(1), parallel_pool(4);
+	DistanceFieldOptions options;
+	options.signed_distance = true;
+	options.max_depth = 5;
+	options.thread_pool = &serial_pool;
+	const BoundingBox bound{ Point(-1.5f), Point(1.5f) };
+	const AdaptiveDistanceField fine(query, bound, options);
+	options.thread_pool = &parallel_pool;
+	const AdaptiveDistanceField parallel(query, bound, options);
+	options.tolerance = 5e-2f;
+	const AdaptiveDistanceField coarse(query, bound, options);
+	EXPECT_LT(coarse.cell_count(), fine.cell_count());
+	EXPECT_GT(coarse.memory_usage(), 0u);
+	EXPECT_EQ(parallel.cell_count(), fine.cell_count());
+	for (const Point& p : random_points(200, 1.5f)) EXPECT_EQ(parallel(p), fine(p));
+}
+
+// Given two triangles at different distances, an unbounded query should find the closer one regardless of insertion order.
+TEST(ClosestPointQuery_MultipleTriangles, ClosestOfTwo) {
+	const Mesh mesh = { {Point(1.0, 0.0, 5.0), Point(0.0, 1.0, 5.0), Point(-1.0, 0.0, 5.0), Point(1.0, 0.0, 0.0), Point(0.0, 1.0, 0.0), Point(-1.0, 0.0, 0.0)} /*vertices*/, {0, 1, 2, 3, 4, 5} /*indices*/ };
+	ClosestPointQuery query(mesh);
+	Point closest_point;
+	bool found = query(Point(0.0, 0.5, 1.0), FLT_MAX, closest_point);
+	EXPECT_TRUE(found);
+	EXPECT_EQ(closest_point, Point(0.0, 0.5, 0.0));
+}
+// Given a triangle whose bounding box is within reach but the triangle itself is not, there shouldn't be any closest points found.
+TEST(ClosestPointQuery_MultipleTriangles, BoundingBoxOnlyInRange) {
+	ClosestPointQuery query(TRIANGLE_MESH);
+	Point closest_point;
+	bool found = query(Point(0.9, 0.9, 0.0), 0.5, closest_point);
+	EXPECT_FALSE(found);
+}
+
+// Given the same mesh, bulk-loading and incremental insertion should find the same closest points.
+TEST(ClosestPointQuery_MultipleTriangles, BulkLoadMatchesIncremental) {
+	const Mesh mesh = wavy_grid_mesh(24);
+	BuildOptions incremental_options;
+	incremental_options.construction = TreeConstruction::Incremental;
+	ClosestPointQuery bulk_loaded(mesh);
+	ClosestPointQuery incremental(mesh, incremental_options);
+	for (const Point& p : random_points(200, 1.5f)) {
+		Point a, b;
+		const float max_dist = p.z() > 0.f ? 0.5f : FLT_MAX;
+		ASSERT_EQ(bulk_loaded(p, max_dist, a), incremental(p, max_dist, b));
+		EXPECT_NEAR(p.distance(a), p.distance(b), 1e-5f);
+	}
+}
+
+// Given the same mesh, serial and parallel bulk-loading should find the same closest points.
+TEST(ClosestPointQuery_MultipleTriangles, ParallelMatchesSerial) {
+	const Mesh mesh = wavy_grid_mesh(200);
+	ThreadPool serial_pool(1), parallel_pool(4);
+	BuildOptions serial_options, parallel_options;
+	serial_options.thread_pool = &serial_pool;
+	parallel_options.thread_pool = &parallel_pool;
+	ClosestPointQuery serial(mesh, serial_options);
+	ClosestPointQuery parallel(mesh, parallel_options);
+	for (const Point& p : random_points(200, 1.5f)) {
+		Point a, b;
+		ASSERT_EQ(serial(p, 0.5f, a), parallel(p, 0.5f, b));
+		EXPECT_NEAR(p.distance(a), p.distance(b), 1e-5f);
+	}
+}
+
+// Given different leaf sizes, including ones that leave the last bucket partially filled, the same closest points should be found.
+TEST(ClosestPointQuery_MultipleTriangles, LeafSizesMatch) {
+	const Mesh mesh = wavy_grid_mesh(24);
+	BuildOptions single_options;
+	single_options.leaf_size = 1;
+	ClosestPointQuery single(mesh, single_options);
+	const size_t leaf_sizes[] = { 3, 8, 16 };
+	for (size_t leaf_size : leaf_sizes) {
+		BuildOptions options;
+		options.leaf_size = leaf_size;
+		ClosestPointQuery bucketed(mesh, options);
+		for (const Point& p : random_points(200, 1.5f)) {
+			Point a, b;
+			ASSERT_EQ(single(p, 0.5f, a), bucketed(p, 0.5f, b));
+			EXPECT_NEAR(p.distance(a), p.distance(b), 1e-5f);
+		}
+	}
+}
+
+// Given random triangles and query points, every lane of a packet should find the same closest point as the scalar kernel.
+template<typename PACKET>
+void expect_packet_matches_scalar() {
+	const std::vector<Point> vertices = random_points(3 * PACKET::WIDTH * 50, 1.f);
+	const std::vector<Point> query_points = random_points(100, 2.f);
+	for (size_t i = 0; i < vertices.size(); i += 3 * PACKET::WIDTH) {
+		PACKET packet;
+		for (size_t lane = 0; lane < PACKET::WIDTH; ++lane) packet.set(lane, vertices[i + lane * 3], vertices[i + lane * 3 + 1], vertices[i + lane * 3 + 2]);
+		for (const Point& p : query_points) {
+			float scalar_distance = FLT_MAX, packet_distance = FLT_MAX;
+			Point scalar_point, packet_point;
+			for (size_t lane = 0; lane < PACKET::WIDTH; ++lane) {
+				const Point triangle[3] = { vertices[i + lane * 3], vertices[i + lane * 3 + 1], vertices[i + lane * 3 + 2] };
+				closest_point_on_triangle(p, triangle, scalar_distance, scalar_point);
+			}
+			ASSERT_TRUE(packet.closest_point(p, packet_distance, packet_point));
+			EXPECT_NEAR(packet_distance, scalar_distance, 1e-4f);
+			EXPECT_NEAR(p.distance2(packet_point), packet_distance, 1e-4f);
+		}
+	}
+}
+TEST(TrianglePacket_ClosestPoint, Float4MatchesScalar) {
+	expect_packet_matches_scalar<TrianglePacket<math::Float4>>();
+	expect_packet_matches_scalar<PrecomputedTrianglePacket<math::Float4>>();
+	expect_packet_matches_scalar<JonesTrianglePacket<math::Float4>>();
+}
+#if defined(MATH_BACKEND_AVX)
+TEST(TrianglePacket_ClosestPoint, Float8MatchesScalar) {
+	expect_packet_matches_scalar<TrianglePacket<math::Float8>>();
+	expect_packet_matches_scalar<PrecomputedTrianglePacket<math::Float8>>();
+	expect_packet_matches_scalar<JonesTrianglePacket<math::Float8>>();
+}
+#endif
+// Given a packet whose triangles are all farther than the shortest distance so far, nothing should be updated.
+TEST(TrianglePacket_ClosestPoint, FartherThanShortest) {
+	TrianglePacket<math::Float4> packet;
+	for (size_t lane = 0; lane < 4; ++lane) packet.set(lane, Point(1.f, 0.f, 0.f), Point(0.f, 1.f, 0.f), Point(-1.f, 0.f, 0.f));
+	float shortest_distance = 0.5f;
+	Point closest_point(7.f);
+	EXPECT_FALSE(packet.closest_point(Point(0.f, 0.5f, 1.f), shortest_distance, closest_point));
+	EXPECT_EQ(shortest_distance, 0.5f);
+	EXPECT_EQ(closest_point, Point(7.f));
+}
+
+// Given the same mesh, the precomputed and Jones triangle kernels should find the same closest points as the default one.
+TEST(ClosestPointQuery_MultipleTriangles, KernelsMatchVertices) {
+	const Mesh mesh = wavy_grid_mesh(24);
+	ClosestPointQuery vertices(mesh);
+	const TriangleKernel kernels[] = { TriangleKernel::Precomputed, TriangleKernel::Jones };
+	for (TriangleKernel kernel : kernels) {
+		BuildOptions options;
+		options.kernel = kernel;
+		ClosestPointQuery query(mesh, options);
+		EXPECT_GT(query.memory_usage(), vertices.memory_usage());
+		for (const Point& p : random_points(200, 1.5f)) {
+			Point a, b;
+			ASSERT_EQ(vertices(p, 0.5f, a), query(p, 0.5f, b));
+			EXPECT_NEAR(p.distance(a), p.distance(b), 1e-5f);
+		}
+	}
+}
+
+// Given indexed storage with 16-bit or 32-bit indices, referencing the mesh or owning it, queries should match the vertices kernel exactly in less memory.
+TEST(ClosestPointQuery_MultipleTriangles, IndexedMatchesVertices) {
+	const int resolutions[] = { 24, 260 }; // 625 and 68121 vertices.
+	for (int resolution : resolutions) {
+		const Mesh mesh = wavy_grid_mesh(resolution);
+		ClosestPointQuery vertices(mesh);
+		BuildOptions options;
+		options.kernel = TriangleKernel::Indexed;
+		ClosestPointQuery referenced(mesh, options);
+		std::unique_ptr<ClosestPointQuery> owned;
+		{
+			Mesh copy = mesh;
+			owned.reset(new ClosestPointQuery(std::move(copy), options));
+		}
+		EXPECT_LT(referenced.memory_usage(), vertices.memory_usage());
+		EXPECT_GT(owned->memory_usage(), referenced.memory_usage());
+		for (const Point& p : random_points(200, 1.5f)) {
+			QueryResult a, b, c;
+			ASSERT_EQ(vertices(p, 0.5f, a), referenced(p, 0.5f, b));
+			ASSERT_EQ(vertices(p, 0.5f, a), (*owned)(p, 0.5f, c));
+			EXPECT_EQ(a.closest_point, b.closest_point);
+			EXPECT_EQ(a.closest_point, c.closest_point);
+			EXPECT_EQ(a.triangle, b.triangle);
+		}
+	}
+}
+
+// Given the kernels that rebuild the vertices from edges or a local frame, the feature and barycentric coordinates of a result
+// should still be exactly those of the triangle in the mesh, as with the vertices kernel, so that the pseudo-normals agree.
+TEST(ClosestPointQuery_MultipleTriangles, ResultsUseMeshVertices) {
+	const Mesh mesh = wavy_grid_mesh(24);
+	BuildOptions build_options;
+	build_options.pseudo_normals = true;
+	ClosestPointQuery vertices(mesh, build_options);
+	std::vector<Point> points = random_points(500, 1.5f);
+	// Points off the vertices and the middle of the edges of the mesh, whose closest feature is a vertex or an edge.
+	for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+		const Point& p1 = mesh.vertices[mesh.indices[i]];
+		const Point& p2 = mesh.vertices[mesh.indices[i + 1]];
+		points.push_back(p1 + Vec3(0.f, 0.f, 0.05f));
+		points.push_back((p1 + p2) * 0.5f + Vec3(0.f, 0.f, 0.05f));
+	}
+	for (TriangleKernel kernel : { TriangleKernel::Precomputed, TriangleKernel::Jones }) {
+		build_options.kernel = kernel;
+		ClosestPointQuery query(mesh, build_options);
+		for (const Point& p : points) {
+			QueryResult a, b;
+			const bool found = vertices(p, 0.5f, a);
+			ASSERT_EQ(found, query(p, 0.5f, b));
+			// Triangles at the same distance may be found in either order, only the same triangle is compared.
+			if (!found || a.triangle != b.triangle) continue;
+			EXPECT_EQ(a.feature, b.feature);
+			EXPECT_EQ(a.barycentric, b.barycentric);
+			EXPECT_EQ(vertices.pseudo_normal(a), query.pseudo_normal(b));
+		}
+	}
+}
+
+// Given a batch of query points, query_batch should match querying them one at a time, with one or per-point maximum distances.
+TEST(ClosestPointQuery_MultipleTriangles, BatchMatchesSingle) {
+	const Mesh mesh = wavy_grid_mesh(24);
+	ClosestPointQuery query(mesh);
+	const std::vector<Point> points = random_points(1000, 1.5f);
+	std::vector<float> max_dists(points.size());
+	for (size_t i = 0; i < points.size(); ++i) max_dists[i] = 0.1f + 0.5f * (i % 3);
+	ThreadPool thread_pool(4);
+	QueryOptions options;
+	options.thread_pool = &thread_pool;
+	std::vector<uint8_t> found(points.size()), found_single(points.size());
+	std::vector<Point> closest_points(points.size()), closest_points_single(points.size());
+	query.query_batch(points, max_dists, found, closest_points, options);
+	for (size_t i = 0; i < points.size(); ++i) {
+		Point closest_point;
+		EXPECT_EQ(found[i] != 0, query(points[i], max_dists[i], closest_point));
+		if (found[i]) {
+			EXPECT_EQ(closest_points[i], closest_point);
+		}
+	}
+	query.query_batch(points, std::vector<float>{ 0.5f }, found_single, closest_points_single);
+	for (size_t i = 0; i < points.size(); ++i) {
+		Point closest_point;
+		EXPECT_EQ(found_single[i] != 0, query(points[i], 0.5f, closest_point));
+		if (found_single[i]) {
+			EXPECT_EQ(closest_points_single[i], closest_point);
+		}
+	}
+}
+
+// Given a sorted query order, query_batch should store the same results at the same indices as the input order.
+TEST(ClosestPointQuery_MultipleTriangles, BatchOrdersMatch) {
+	const Mesh mesh = wavy_grid_mesh(24);
+	ClosestPointQuery query(mesh);
+	const std::vector<Point> points = random_points(2000, 1.5f);
+	std::vector<uint8_t> found(points.size());
+	std::vector<Point> closest_points(points.size());
+	query.query_batch(points, std::vector<float>{ 0.5f }, found, closest_points);
+	const QueryOrder orders[] = { QueryOrder::Morton, QueryOrder::Hilbert };
+	for (QueryOrder order : orders) {
+		QueryOptions options;
+		options.order = order;
+		std::vector<uint8_t> sorted_found(points.size());
+		std::vector<Point> sorted_closest_points(points.size());
+		query.query_batch(points, std::vector<float>{ 0.5f }, sorted_found, sorted_closest_points, options);
+		EXPECT_EQ(sorted_found, found);
+		for (size_t i = 0; i < points.size(); ++i) {
+			if (found[i]) {
+				EXPECT_EQ(sorted_closest_points[i], closest_points[i]);
+			}
+		}
+	}
+}
+
+// Given the packet traversal, query_batch should find the same closest distances as one query at a time, including partial packets.
+TEST(ClosestPointQuery_MultipleTriangles, PacketTraversalMatchesSingle) {
+	const Mesh mesh = wavy_grid_mesh(24);
+	const TriangleKernel kernels[] = { TriangleKernel::Vertices, TriangleKernel::Precomputed, TriangleKernel::Jones, TriangleKernel::Indexed };
+	for (TriangleKernel kernel : kernels) {
+		BuildOptions build_options;
+		build_options.kernel = kernel;
+		ClosestPointQuery query(mesh, build_options);
+		const std::vector<Point> points = random_points(1003, 1.5f);
+		std::vector<float> max_dists(points.size());
+		for (size_t i = 0; i < points.size(); ++i) max_dists[i] = i % 7 == 0 ? FLT_MAX : 0.1f + 0.2f * (i % 3);
+		const QueryOrder orders[] = { QueryOrder::Input, QueryOrder::Morton };
+		for (QueryOrder order : orders) {
+			QueryOptions options;
+			options.order = order;
+			options.traversal = QueryTraversal::Packet;
+			std::vector<uint8_t> found(points.size());
+			std::vector<Point> closest_points(points.size());
+			query.query_batch(points, max_dists, found, closest_points, options);
+			for (size_t i = 0; i < points.size(); ++i) {
+				Point closest_point;
+				ASSERT_EQ(found[i] != 0, query(points[i], max_dists[i], closest_point));
+				if (found[i]) {
+					EXPECT_NEAR(points[i].distance(closest_points[i]), points[i].distance(closest_point), 1e-6f);
+				}
+			}
+		}
+	}
+}
+
+// Given query points out of reach, both traversals should leave their closest points untouched, as a single query does.
+TEST(ClosestPointQuery_MultipleTriangles, BatchKeepsClosestPointsNotFound) {
+	const Mesh mesh = wavy_grid_mesh(24);
+	ClosestPointQuery query(mesh);
+	const std::vector<Point> points = random_points(1003, 1.5f);
+	const Point sentinel(-123.f, 456.f, -789.f);
+	const QueryTraversal traversals[] = { QueryTraversal::Single, QueryTraversal::Packet };
+	for (QueryTraversal traversal : traversals) {
+		QueryOptions options;
+		options.traversal = traversal;
+		std::vector<uint8_t> found(points.size());
+		std::vector<Point> closest_points(points.size(), sentinel);
+		query.query_batch(points, std::vector<float>{ 0.1f }, found, closest_points, options);
+		size_t not_found_count = 0;
+		for (size_t i = 0; i < points.size(); ++i) {
+			if (!found[i]) {
+				EXPECT_EQ(closest_points[i], sentinel);
+				++not_found_count;
+			}
+		}
+		EXPECT_GT(not_found_count, 0u);
+	}
+}
+
+// Given quantized child boxes, the single and packet traversals of a query should find the same distances as with float boxes.
+TEST(ClosestPointQuery_MultipleTriangles, QuantizedBoundsMatchFloat) {
+	const Mesh mesh = wavy_grid_mesh(24);
+	ClosestPointQuery float_query(mesh);
+	const std::vector<Point> points = random_points(1003, 1.5f);
+	for (NodeBounds node_bounds : { NodeBounds::Quantized16, NodeBounds::Quantized8 }) {
+		BuildOptions build_options;
+		build_options.node_bounds = node_bounds;
+		ClosestPointQuery query(mesh, build_options);
+		EXPECT_LT(query.memory_usage(), float_query.memory_usage());
+		const QueryTraversal traversals[] = { QueryTraversal::Single, QueryTraversal::Packet };
+		for (QueryTraversal traversal : traversals) {
+			QueryOptions options;
+			options.traversal = traversal;
+			std::vector<uint8_t> found(points.size());
+			std::vector<Point> closest_points(points.size());
+			query.query_batch(points, std::vector<float>{ 0.3f }, found, closest_points, options);
+			for (size_t i = 0; i < points.size(); ++i) {
+				Point closest_point;
+				ASSERT_EQ(found[i] != 0, float_query(points[i], 0.3f, closest_point));
+				if (found[i]) {
+					EXPECT_EQ(points[i].distance(closest_points[i]), points[i].distance(closest_point));
+				}
+			}
+		}
+	}
+}
+
+// A scene of translated copies of the wavy grid and the cube, with an empty mesh in between.
+std::vector<Mesh> scene_meshes() {
+	std::vector<Mesh> meshes;
+	for (int i = 0; i < 5; ++i) {
+		Mesh mesh = i % 2 == 0 ? wavy_grid_mesh(8 + i) : CUBE_MESH;
+		for (Point& v : mesh.vertices) v = v * 0.5f + Point(1.2f * (i - 2), 0.3f * i, 0.f);
+		meshes.push_back(mesh);
+	}
+	meshes.insert(meshes.begin() + 2, Mesh());
+	return meshes;
+}
+
+// Given several meshes, the scene should find the closest of the closest points on every mesh, and report the mesh it lies on.
+TEST(SceneClosestPointQuery_Query, MatchesClosestMesh) {
+	const std::vector<Mesh> meshes = scene_meshes();
+	SceneClosestPointQuery scene(meshes);
+	ASSERT_EQ(scene.mesh_count(), meshes.size());
+	const std::vector<Point> points = random_points(1000, 3.f);
+	for (const Point& p : points) {
+		const float max_dist = 0.75f;
+		float best_distance2 = FLT_MAX;
+		for (size_t mesh = 0; mesh < meshes.size(); ++mesh) {
+			QueryResult mesh_result;
+			if (scene.mesh_query(mesh)(p, max_dist, mesh_result)) best_distance2 = std::min(best_distance2, mesh_result.distance2);
+		}
+		SceneQueryResult result;
+		ASSERT_EQ(scene(p, max_dist, result), best_distance2 != FLT_MAX);
+		if (best_distance2 == FLT_MAX) continue;
+		EXPECT_FLOAT_EQ(result.distance2, best_distance2);
+		ASSERT_LT(result.mesh, meshes.size());
+		QueryResult mesh_result;
+		ASSERT_TRUE(scene.mesh_query(result.mesh)(p, max_dist, mesh_result));
+		EXPECT_EQ(result.triangle, mesh_result.triangle);
+		EXPECT_EQ(result.closest_point, mesh_result.closest_point);
+	}
+}
+
+// Given a query point beyond the maximum distance of every mesh, the scene should find nothing and leave the result untouched.
+TEST(SceneClosestPointQuery_Query, NotFound) {
+	const std::vector<Mesh> meshes = scene_meshes();
+	SceneClosestPointQuery scene(meshes);
+	SceneQueryResult result;
+	result.mesh = 42;
+	EXPECT_FALSE(scene(Point(0.f, 0.f, 10.f), 1.f, result));
+	EXPECT_EQ(result.mesh, 42u);
+	EXPECT_TRUE(scene(Point(0.f, 0.f, 10.f), FLT_MAX, result));
+	const std::vector<Mesh> empty_meshes{ Mesh() };
+	SceneClosestPointQuery empty(empty_meshes);
+	EXPECT_FALSE(empty(Point(0.f, 0.f, 0.f), FLT_MAX, result));
+}
+
+// Given a sorted batch over several threads, query_batch on a scene should match querying the points one at a time.
+TEST(SceneClosestPointQuery_Query, BatchMatchesSingle) {
+	ThreadPool thread_pool(4);
+	BuildOptions build_options;
+	build_options.thread_pool = &thread_pool;
+	const std::vector<Mesh> meshes = scene_meshes();
+	SceneClosestPointQuery scene(meshes, build_options);
+	const std::vector<Point> points = random_points(1000, 3.f);
+	QueryOptions options;
+	options.thread_pool = &thread_pool;
+	options.order = QueryOrder::Morton;
+	std::vector<uint8_t> found(points.size());
+	std::vector<SceneQueryResult> results(points.size());
+	scene.query_batch(points, std::vector<float>{ 0.5f }, found, results, options);
+	for (size_t i = 0; i < points.size(); ++i) {
+		SceneQueryResult result;
+		ASSERT_EQ(found[i] != 0, scene(points[i], 0.5f, result));
+		if (!found[i]) continue;
+		EXPECT_EQ(results[i].mesh, result.mesh);
+		EXPECT_EQ(results[i].closest_point, result.closest_point);
+	}
+}
+
+// Given rotated and translated instances of a mesh, the scene should match a scene of transformed copies, while holding a single copy.
+TEST(SceneClosestPointQuery_Instances, MatchesTransformedCopies) {
+	const std::vector<Mesh> meshes = { wavy_grid_mesh(12), CUBE_MESH };
+	std::vector<MeshInstance> instances;
+	std::vector<Mesh> copies;
+	for (int i = 0; i < 12; ++i) {
+		MeshInstance instance;
+		instance.mesh = i % 3 == 0 ? 1 : 0;
+		instance.transform = RigidTransform::from_axis_angle(Vec3(1.f, 2.f, 0.5f * i), 0.7f * i, Vec3(1.5f * (i % 4), 1.5f * (i / 4), 0.2f * i));
+		instances.push_back(instance);
+		Mesh copy = meshes[instance.mesh];
+		for (Point& v : copy.vertices) v = instance.transform.apply(v);
+		copies.push_back(copy);
+	}
+	SceneClosestPointQuery scene(meshes, instances), copies_scene(copies);
+	ASSERT_EQ(scene.instance_count(), instances.size());
+	EXPECT_LT(scene.memory_usage(), copies_scene.memory_usage());
+	const std::vector<Point> points = random_points(1000, 4.f);
+	for (const Point& p : points) {
+		const Point q = p + Point(2.f, 1.5f, 1.f);
+		SceneQueryResult result, copy_result;
+		ASSERT_EQ(scene(q, 0.6f, result), copies_scene(q, 0.6f, copy_result));
+		if (copy_result.mesh == UINT32_MAX) continue;
+		EXPECT_NEAR(sqrtf(result.distance2), sqrtf(copy_result.distance2), 1e-5f);
+		EXPECT_NEAR(q.distance(result.closest_point), sqrtf(result.distance2), 1e-5f);
+		EXPECT_EQ(result.mesh, instances[result.instance].mesh);
+		// The barycentric coordinates refer to the triangle of the mesh in its own space.
+		const Mesh& mesh = meshes[result.mesh];
+		const Point local = mesh.vertices[mesh.indices[result.triangle * 3 + 0]] * result.barycentric.x() + mesh.vertices[mesh.indices[result.triangle * 3 + 1]] * result.barycentric.y()
+			+ mesh.vertices[mesh.indices[result.triangle * 3 + 2]] * result.barycentric.z();
+		EXPECT_NEAR(instances[result.instance].transform.apply(local).distance(result.closest_point), 0.f, 1e-5f);
+	}
+}
+
+// Given a small fanout, repeated splits should keep every node within its capacity and every entry reachable.
+TEST(RStarTree_Insert, SmallFanout) {
+	RStarTree<int, 4> tree;
+	for (int i = 0; i < 1000; ++i) tree.insert(Point(float(i % 10), float(i / 10 % 10), float(i / 100)), Point(float(i % 10) + 0.5f, float(i / 10 % 10) + 0.5f, float(i / 100) + 0.5f), i);
+	EXPECT_EQ(tree.count(), 1000u);
+	std::vector<bool> visited(1000, false);
+	tree.search_radius(Point(5.f, 5.f, 5.f), FLT_MAX, [&](int i) { visited[i] = true; return true; });
+	EXPECT_EQ(std::count(visited.begin(), visited.end(), true), 1000);
+}
+// Given splits on a large fanout, every node except the root should hold between MIN_NODE and MAX_NODE children.
+TEST(RStarTree_Insert, NodeOccupancy) {
+	RStarTree<int, 16> tree;
+	for (int i = 0; i < 5000; ++i) tree.insert(Point(float(i % 17), float(i / 17 % 17), float(i / 289)), Point(float(i % 17) + 0.5f, float(i / 17 % 17) + 0.5f, float(i / 289) + 0.5f), i);
+	bool valid_occupancy = true;
+	tree.traverse_bfs([&](int, Node* node) {
+		if (node->is_leaf) return;
+		const auto* internal = static_cast<InternalNode<int, 16, 6>*>(node);
+		valid_occupancy &= internal->children.size() >= 6 && internal->children.size() <= 16;
+	});
+	EXPECT_TRUE(valid_occupancy);
+}
+
+// Given entries with a non-trivial destructor, destroying the tree should destroy every entry exactly once.
+TEST(RStarTree_Insert, DestroysEntries) {
+	const std::shared_ptr<int> counter = std::make_shared<int>(0);
+	{
+		RStarTree<std::shared_ptr<int>, 8> tree;
+		for (int i = 0; i < 100; ++i) tree.insert(Point(float(i), 0.f, 0.f), Point(float(i) + 0.5f, 0.5f, 0.5f), counter);
+		EXPECT_EQ(counter.use_count(), 101);
+		EXPECT_GT(tree.memory_usage(), 0u);
+	}
+	EXPECT_EQ(counter.use_count(), 1);
+}
+
+// Check that every node below the root holds between MIN_NODE and MAX_NODE children.
+bool valid_occupancy(const RStarTree<int, 16>& tree) {
+	bool valid = true;
+	tree.traverse_bfs([&](int, Node* node) {
+		if (node->is_leaf) return;
+		const auto* internal = static_cast<InternalNode<int, 16, 6>*>(node);
+		valid &= internal->children.size() >= 6 && internal->children.size() <= 16;
+	});
+	return valid;
+}
+// Given a bulk-loaded tree, every entry should be reachable and the tree bound should enclose all entries.
+TEST(RStarTree_BulkLoad, AllEntriesReachable) {
+	std::vector<std::pair<BoundingBox, int>> entries;
+	for (int i = 0; i < 1000; ++i) entries.push_back({ BoundingBox{ Point(float(i % 10), float(i / 10 % 10), float(i / 100)), Point(float(i % 10) + 0.5f, float(i / 10 % 10) + 0.5f, float(i / 100) + 0.5f) }, i });
+	RStarTree<int, 8> tree;
+	tree.bulk_load(entries);
+	EXPECT_EQ(tree.count(), 1000u);
+	EXPECT_EQ(tree.bound(), BoundingBox(Point(0.f, 0.f, 0.f), Point(9.5f, 9.5f, 9.5f)));
+	std::vector<int> visited;
+	tree.search_radius(Point(5.f, 5.f, 5.f), FLT_MAX, [&](int i) { visited.push_back(i); return true; });
+	std::sort(visited.begin(), visited.end());
+	ASSERT_EQ(visited.size(), 1000u);
+	for (int i = 0; i < 1000; ++i) EXPECT_EQ(visited[i], i);
+}
+// Given a bulk-loaded tree, incremental insertion should still work on top of it.
+TEST(RStarTree_BulkLoad, InsertAfterBulkLoad) {
+	std::vector<std::pair<BoundingBox, int>> entries;
+	for (int i = 0; i < 100; ++i) entries.push_back({ BoundingBox{ Point(float(i), 0.f, 0.f), Point(float(i) + 0.5f, 0.5f, 0.5f) }, i });
+	RStarTree<int, 8> tree;
+	tree.bulk_load(entries);
+	for (int i = 100; i < 200; ++i) tree.insert(Point(float(i), 0.f, 0.f), Point(float(i) + 0.5f, 0.5f, 0.5f), i);
+	EXPECT_EQ(tree.count(), 200u);
+	std::vector<int> visited;
+	tree.search_nearest(Point(150.2f, 0.2f, 0.2f), FLT_MAX, [&](int i) -> float { visited.push_back(i); return 0.f; });
+	EXPECT_EQ(visited, std::vector<int>({ 150 }));
+}
+
+// Given a bulk-loaded tree built on a thread pool, every entry should be reachable, all leaves should be at the same depth and every node below the root at least MIN_NODE full.
+TEST(RStarTree_BulkLoad, ParallelAllEntriesReachable) {
+	std::vector<std::pair<BoundingBox, int>> entries;
+	for (int i = 0; i < 100000; ++i) entries.push_back({ BoundingBox{ Point(float(i % 50), float(i / 50 % 50), float(i / 2500)), Point(float(i % 50) + 0.5f, float(i / 50 % 50) + 0.5f, float(i / 2500) + 0.5f) }, i });
+	ThreadPool thread_pool(4);
+	RStarTree<int, 16> tree;
+	tree.bulk_load(entries, &thread_pool);
+	EXPECT_EQ(tree.count(), 100000u);
+	int leaf_layer = -1;
+	bool same_depth = true;
+	tree.traverse_bfs([&](int layer, Node* node) {
+		if (!node->is_leaf) return;
+		if (leaf_layer == -1) leaf_layer = layer;
+		same_depth &= leaf_layer == layer;
+	});
+	EXPECT_TRUE(same_depth);
+	std::vector<bool> visited(entries.size(), false);
+	tree.search_radius(Point(25.f, 25.f, 20.f), FLT_MAX, [&](int i) { visited[i] = true; return true; });
+	EXPECT_EQ(std::count(visited.begin(), visited.end(), true), 100000);
+	EXPECT_TRUE(valid_occupancy(tree));
+	// A few outliers fall into Morton buckets of their own, their range must not be packed into underfilled parents.
+	for (int i = 0; i < 3; ++i) entries.push_back({ BoundingBox{ Point(1000.f + i, 1000.f, 1000.f), Point(1000.5f + i, 1000.5f, 1000.5f) }, 100000 + i });
+	RStarTree<int, 16> skewed_tree;
+	skewed_tree.bulk_load(entries, &thread_pool);
+	EXPECT_EQ(skewed_tree.count(), 100003u);
+	EXPECT_TRUE(valid_occupancy(skewed_tree));
+}
+
+// Given boxes along the x-axis, nearest-first search should visit the closest box first and prune the rest once it reports a zero radius.
+TEST(RStarTree_Search, NearestFirst) {
+	RStarTree<int, 8> tree;
+	for (int i = 0; i < 32; ++i) tree.insert(Point(float(i), 0.f, 0.f), Point(float(i) + 0.5f, 0.5f, 0.5f), i);
+	std::vector<int> visited;
+	tree.search_nearest(Point(10.2f, 0.2f, 0.2f), FLT_MAX, [&](int i) -> float { visited.push_back(i); return 0.f; });
+	ASSERT_EQ(visited.size(), 1u);
+	EXPECT_EQ(visited[0], 10);
+}
+// Given a bounded nearest-first search that never shrinks, the closest box should come first and only boxes within the radius are visited.
+TEST(RStarTree_Search, BoundedRadius) {
+	RStarTree<int, 8> tree;
+	for (int i = 0; i < 32; ++i) tree.insert(Point(float(i), 0.f, 0.f), Point(float(i) + 0.5f, 0.5f, 0.5f), i);
+	std::vector<int> visited;
+	tree.search_nearest(Point(10.2f, 0.2f, 0.2f), 3.f, [&](int i) -> float { visited.push_back(i); return FLT_MAX; });
+	ASSERT_FALSE(visited.empty());
+	EXPECT_EQ(visited[0], 10);
+	std::sort(visited.begin(), visited.end());
+	EXPECT_EQ(visited, std::vector<int>({ 7, 8, 9, 10, 11, 12, 13 }));
+}
+// Given a negative radius, neither the nearest-first search nor the flattened tree should visit any entry, as with search_radius().
+TEST(RStarTree_Search, NegativeRadius) {
+	RStarTree<int, 8> tree;
+	for (int i = 0; i < 32; ++i) tree.insert(Point(float(i), 0.f, 0.f), Point(float(i) + 0.5f, 0.5f, 0.5f), i);
+	const FrozenRStarTree<int, 8> frozen_tree(tree);
+	size_t visit_count = 0;
+	tree.search_radius(Point(10.2f, 0.2f, 0.2f), -1.f, [&](int) { ++visit_count; return true; });
+	tree.search_nearest(Point(10.2f, 0.2f, 0.2f), -1.f, [&](int) -> float { ++visit_count; return FLT_MAX; });
+	frozen_tree.search_nearest(Point(10.2f, 0.2f, 0.2f), -1.f, [&](int) -> float { ++visit_count; return FLT_MAX; });
+	frozen_tree.search_radius(Point(10.2f, 0.2f, 0.2f), -1.f, [&](int) { ++visit_count; return true; });
+	EXPECT_EQ(visit_count, 0u);
+}
+// Given a callback that asks to stop, the radius search should not visit any further entries.
+TEST(RStarTree_Search, RadiusEarlyExit) {
+	RStarTree<int, 8> tree;
+	for (int i = 0; i < 32; ++i) tree.insert(Point(float(i), 0.f, 0.f), Point(float(i) + 0.5f, 0.5f, 0.5f), i);
+	size_t visit_count = 0;
+	tree.search_radius(Point(10.2f, 0.2f, 0.2f), FLT_MAX, [&](int) { return ++visit_count < 3; });
+	EXPECT_EQ(visit_count, 3u);
+}
+
+// Given a frozen tree, the radius search should visit the same entries as the tree it was flattened from, including partially filled packets.
+TEST(FrozenRStarTree_Search, RadiusMatchesRStarTree) {
+	RStarTree<int, 6> tree;
+	const std::vector<Point> points = random_points(500, 10.f);
+	for (int i = 0; i < 500; ++i) tree.insert(points[i], points[i] + Vec3(0.5f), i);
+	const FrozenRStarTree<int, 6> frozen_tree(tree);
+	EXPECT_EQ(frozen_tree.count(), 500u);
+	EXPECT_EQ(frozen_tree.bound(), tree.bound());
+	for (const Point& p : random_points(50, 12.f)) {
+		std::vector<int> expected, visited;
+		tree.search_radius(p, 3.f, [&](int i) { expected.push_back(i); return true; });
+		frozen_tree.search_radius(p, 3.f, [&](int i) { visited.push_back(i); return true; });
+		std::sort(expected.begin(), expected.end());
+		std::sort(visited.begin(), visited.end());
+		EXPECT_EQ(visited, expected);
+	}
+}
+// Given a frozen tree, the nearest-first search should find the same closest box as the tree it was flattened from.
+TEST(FrozenRStarTree_Search, NearestMatchesRStarTree) {
+	std::vector<std::pair<BoundingBox, int>> entries;
+	const std::vector<Point> points = random_points(500, 10.f);
+	for (int i = 0; i < 500; ++i) entries.push_back({ BoundingBox{ points[i], points[i] + Vec3(0.5f) }, i });
+	RStarTree<int, 6> tree;
+	tree.bulk_load(entries);
+	const FrozenRStarTree<int, 6> frozen_tree(tree);
+	for (const Point& p : random_points(50, 12.f)) {
+		std::vector<int> expected, visited;
+		tree.search_nearest(p, FLT_MAX, [&](int i) -> float { expected.push_back(i); return 0.f; });
+		frozen_tree.search_nearest(p, FLT_MAX, [&](int i) -> float { visited.push_back(i); return 0.f; });
+		ASSERT_EQ(visited.size(), 1u);
+		EXPECT_EQ(entries[visited[0]].first.distance2(p), entries[expected[0]].first.distance2(p));
+	}
+}
+// Given an empty tree, the frozen tree should be empty and never invoke the callback.
+TEST(FrozenRStarTree_Search, Empty) {
+	const RStarTree<int, 8> tree;
+	const FrozenRStarTree<int, 8> frozen_tree(tree);
+	EXPECT_EQ(frozen_tree.count(), 0u);
+	size_t visit_count = 0;
+	frozen_tree.search_radius(Point(0.f), FLT_MAX, [&](int) { return ++visit_count > 0; });
+	frozen_tree.search_nearest(Point(0.f), FLT_MAX, [&](int) -> float { ++visit_count; return FLT_MAX; });
+	EXPECT_EQ(visit_count, 0u);
+}
+
+// Given quantized child boxes, every decoded entry box should contain the original one, also far from the origin and on a flat axis.
+TEST(FrozenRStarTree_Quantized, BoundsContainEntries) {
+	const std::vector<Point> points = random_points(500, 10.f);
+	const Vec3 offsets[] = { Vec3(0.f), Vec3(1000.f, -3000.f, 0.001f) };
+	for (size_t flat = 0; flat < 2; ++flat) {
+		std::vector<std::pair<BoundingBox, int>> entries;
+		for (int i = 0; i < 500; ++i) {
+			const Point min = points[i] * Vec3(1.f, 1.f, float(1 - flat)) + offsets[flat];
+			entries.push_back({ BoundingBox{ min, min + Vec3(0.5f, 0.25f, flat ? 0.f : 0.1f * (i % 5)) }, i });
+		}
+		RStarTree<int, 6> tree;
+		tree.bulk_load(entries);
+		const FrozenRStarTree<int, 6> float_tree(tree), tree16(tree, NodeBounds::Quantized16), tree8(tree, NodeBounds::Quantized8);
+		EXPECT_LT(tree16.memory_usage(), float_tree.memory_usage());
+		EXPECT_LT(tree8.memory_usage(), tree16.memory_usage());
+		for (const FrozenRStarTree<int, 6>* quantized : { &tree16, &tree8 }) {
+			EXPECT_EQ(quantized->bound(), tree.bound());
+			std::vector<int> visited;
+			quantized->search_box(tree.bound(), 0.f, [&](int i, const BoundingBox& b) {
+				EXPECT_TRUE(b.is_enclosing(entries[i].first));
+				visited.push_back(i);
+				return true;
+			});
+			std::sort(visited.begin(), visited.end());
+			ASSERT_EQ(visited.size(), entries.size());
+			for (int i = 0; i < 500; ++i) EXPECT_EQ(visited[i], i);
+		}
+	}
+}
+// Given quantized child boxes, the searches should find the same entries as with float boxes, only visiting a few more on the way.
+TEST(FrozenRStarTree_Quantized, SearchesMatchFloat) {
+	std::vector<std::pair<BoundingBox, int>> entries;
+	const std::vector<Point> points = random_points(500, 10.f);
+	for (int i = 0; i < 500; ++i) entries.push_back({ BoundingBox{ points[i], points[i] + Vec3(0.5f) }, i });
+	RStarTree<int, 6> tree;
+	tree.bulk_load(entries);
+	const FrozenRStarTree<int, 6> float_tree(tree);
+	for (NodeBounds node_bounds : { NodeBounds::Quantized16, NodeBounds::Quantized8 }) {
+		const FrozenRStarTree<int, 6> quantized(tree, node_bounds);
+		for (const Point& p : random_points(50, 12.f)) {
+			// Only keep the entries truly within the radius, the decoded boxes may let a few more through.
+			std::vector<int> expected, visited;
+			const auto within = [&](int i) { return entries[i].first.distance2(p) <= 9.f; };
+			float_tree.search_radius(p, 3.f, [&](int i) { if (within(i)) expected.push_back(i); return true; });
+			quantized.search_radius(p, 3.f, [&](int i) { if (within(i)) visited.push_back(i); return true; });
+			std::sort(expected.begin(), expected.end());
+			std::sort(visited.begin(), visited.end());
+			EXPECT_EQ(visited, expected);
+			float expected2 = FLT_MAX, visited2 = FLT_MAX;
+			float_tree.search_nearest(p, FLT_MAX, [&](int i) -> float { return expected2 = std::min(expected2, entries[i].first.distance2(p)); });
+			quantized.search_nearest(p, FLT_MAX, [&](int i) -> float { return visited2 = std::min(visited2, entries[i].first.distance2(p)); });
+			EXPECT_EQ(visited2, expected2);
+		}
+	}
+}
+
+// Given a parallel_for, every index should be visited exactly once, regardless of the pool size.
+TEST(ThreadPool_ParallelFor, VisitsAllIndices) {
+	for (size_t thread_count = 1; thread_count <= 4; ++thread_count) {
+		ThreadPool thread_pool(thread_count);
+		EXPECT_EQ(thread_pool.thread_count(), thread_count);
+		std::vector<std::atomic<int>> visits(1000);
+		for (auto& v : visits) v = 0;
+		thread_pool.parallel_for(visits.size(), [&](size_t i) { visits[i]++; });
+		for (const auto& v : visits) EXPECT_EQ(v, 1);
+	}
+}
+// Given back to back parallel_for calls on the same pool, each call should complete before returning.
+TEST(ThreadPool_ParallelFor, Repeated) {
+	ThreadPool thread_pool(4);
+	std::atomic<size_t> sum{ 0 };
+	for (size_t round = 1; round <= 100; ++round) {
+		thread_pool.parallel_for(round, [&](size_t i) { sum += i; });
+		EXPECT_EQ(sum, round * (round - 1) / 2);
+		sum = 0;
+	}
+}
+
+// Given a parallel_for_chunked, every index should be covered by exactly one chunk no larger than the chunk size.
+TEST(ThreadPool_ParallelForChunked, VisitsAllIndices) {
+	const size_t counts[] = { 1, 7, 1000, 4099 };
+	const size_t chunk_sizes[] = { 1, 16, 5000 };
+	for (size_t thread_count = 1; thread_count <= 4; ++thread_count) {
+		ThreadPool thread_pool(thread_count);
+		for (size_t count : counts) {
+			for (size_t chunk_size : chunk_sizes) {
+				std::vector<std::atomic<int>> visits(count);
+				for (auto& v : visits) v = 0;
+				std::atomic<bool> oversized{ false };
+				thread_pool.parallel_for_chunked(count, chunk_size, [&](size_t begin, size_t end) {
+					if (begin >= end || end - begin > chunk_size) oversized = true;
+					for (size_t i = begin; i < end; ++i) visits[i]++;
+				});
+				EXPECT_FALSE(oversized);
+				for (const auto& v : visits) EXPECT_EQ(v, 1);
+			}
+		}
+	}
+}
+// Given uneven chunks, the threads done early should steal from the busy ones and every chunk should still complete.
+TEST(ThreadPool_ParallelForChunked, UnevenWork) {
+	ThreadPool thread_pool(4);
+	std::atomic<size_t> sum{ 0 };
+	thread_pool.parallel_for_chunked(256, 4, [&](size_t begin, size_t end) {
+		if (begin < 64) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		for (size_t i = begin; i < end; ++i) sum += i;
+	});
+	EXPECT_EQ(sum, 256u * 255u / 2);
+}
+
+// Given the cells of the corner cube of the grid, the Hilbert curve should visit each of them once, stepping to an adjacent cell every time.
+TEST(SpaceFillingCurve_Hilbert, AdjacentCells) {
+	const BoundingBox bound{ Point(0.f), Point(1024.f) };
+	const uint32_t side = 16;
+	std::vector<int> cells(side * side * side, -1);
+	for (uint32_t x = 0; x < side; ++x) {
+		for (uint32_t y = 0; y < side; ++y) {
+			for (uint32_t z = 0; z < side; ++z) {
+				const uint32_t code = hilbert_code(Point(x + 0.5f, y + 0.5f, z + 0.5f), bound);
+				ASSERT_LT(code, cells.size());
+				EXPECT_EQ(cells[code], -1);
+				cells[code] = static_cast<int>((x * side + y) * side + z);
+			}
+		}
+	}
+	for (size_t i = 1; i < cells.size(); ++i) {
+		const int a = cells[i - 1], b = cells[i];
+		const int distance = abs(a / 256 - b / 256) + abs(a / 16 % 16 - b / 16 % 16) + abs(a % 16 - b % 16);
+		EXPECT_EQ(distance, 1);
+	}
+}
+// Given the cells of the grid, the Z-order curve should interleave the bits with x the most significant.
+TEST(SpaceFillingCurve_Morton, InterleavedBits) {
+	const BoundingBox bound{ Point(0.f), Point(1024.f) };
+	EXPECT_EQ(morton_code(Point(0.5f), bound), 0u);
+	EXPECT_EQ(morton_code(Point(1.5f, 0.5f, 0.5f), bound), 4u);
+	EXPECT_EQ(morton_code(Point(0.5f, 1.5f, 0.5f), bound), 2u);
+	EXPECT_EQ(morton_code(Point(0.5f, 0.5f, 1.5f), bound), 1u);
+	EXPECT_EQ(morton_code(Point(1023.5f), bound), (1u << 30) - 1);
+}
+
 TEST(BoundingBox_Intersection, Overlap) {
 	BoundingBox a{ Point(0, 0, 0), Point(1, 1, 1) };
 	BoundingBox b{ Point(0.5, 0.5, 0.5), Point(1.5, 1.5, 1.5) };
@@ -1,12 +1,23 @@
+newoption {
+   trigger = "simd",
+   value = "BACKEND",
+   description = "Instruction set used by the math library",
+   default = "sse4",
+   allowed = {
+      { "sse4", "SSE4.1 (x86-64)" },
+      { "avx2", "AVX2 and FMA, 8-wide packets (x86-64)" },
+      { "neon", "NEON (ARM64)" },
+      { "scalar", "Portable fallback without intrinsics" },
+   }
+}
+
 workspace "ClosestPointQuery"
    startproject "Example"
    systemversion "latest"
    language "C++"
    cppdialect "C++11"
-   toolset "msc" -- clang/gcc/msc
    configurations { "Debug", "Release" }
    platforms { "Win64" }
-   buildoptions "/MT"
    
    objdir ("bin/obj")
    targetdir ("bin/%{cfg.platform}/%{cfg.buildcfg}")
@@ -22,6 +33,25 @@ workspace "ClosestPointQuery"
    filter { "platforms:Win64" }
       architecture "x86_64"
 
+   filter { "system:windows" }
+      toolset "msc" -- clang/gcc/msc
+      buildoptions "/MT"
+   filter { "system:linux" }
+      links { "pthread" }
+
+   -- The backend is picked in Platform.h from the instruction sets enabled here.
+   filter { "options:simd=sse4" }
+      vectorextensions "SSE4.1"
+   filter { "options:simd=avx2" }
+      vectorextensions "AVX2"
+   filter { "options:simd=avx2", "toolset:not msc*" }
+      buildoptions { "-mfma" }
+   filter { "options:simd=neon" }
+      architecture "ARM64"
+   filter { "options:simd=scalar" }
+      defines { "MATH_BACKEND_SCALAR" }
+   filter {}
+
 project "ClosestPointQuery"
    kind "StaticLib"
    files { 
@@ -46,6 +76,20 @@ project "Example"
       "ClosestPointQuery/lib/tinyobjloader",
    }
    
+project "Benchmark"
+   kind "ConsoleApp"
+   files { 
+      "ClosestPointQuery/include/**.h", 
+      "ClosestPointQuery/src/**.cpp",
+      "ClosestPointQuery/benchmark/**.h",
+      "ClosestPointQuery/benchmark/**.cpp"
+   }
+   includedirs { 
+      "ClosestPointQuery/include",
+      "ClosestPointQuery/lib/glm",
+      "ClosestPointQuery/lib/tinyobjloader",
+   }
+   
 project "UnitTest"
    kind "ConsoleApp"
    links {